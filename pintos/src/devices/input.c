@@ -41,6 +41,34 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves up to SIZE keys from the input buffer into BUF and
+   returns the number retrieved.  If the buffer is empty and WAIT
+   is true, waits for a key to be pressed; after that, stops at
+   the end of a line or when no more keys are waiting, whichever
+   comes first, so that a reader gets a whole line of input at a
+   time without waiting for more.  If WAIT is false, returns 0
+   when the buffer is empty.  Interrupts are turned off only once
+   for all the keys.  Returns 0 without waiting if SIZE is 0. */
+size_t
+input_read (uint8_t *buf, size_t size, bool wait) 
+{
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  while (cnt < size && ((cnt == 0 && wait) || !intq_empty (&buffer)))
+    {
+      uint8_t key = intq_getc (&buffer);
+      buf[cnt++] = key;
+      if (key == '\r' || key == '\n')
+        break;
+    }
+  serial_notify ();
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
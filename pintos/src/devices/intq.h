@@ -17,8 +17,13 @@
    protect kernel threads from one another, not from interrupt
    handlers. */
 
-/* Queue buffer size, in bytes. */
-#define INTQ_BUFSIZE 64
+/* Queue buffer size, in bytes.  Large enough to hold a few lines
+   of input typed or pasted ahead of the program reading it.
+   The serial transmit queue is this size too, so a burst of up
+   to this much console output is queued without the writer
+   waiting for the port; serial_flush() still drains it all
+   before a shutdown or panic. */
+#define INTQ_BUFSIZE 1024
 
 /* A circular queue of bytes. */
 struct intq
@@ -5,9 +5,13 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -91,6 +95,9 @@ shutdown_power_off (void)
   const char *p;
 
 #ifdef FILESYS
+#ifdef USERPROG
+  process_done ();
+#endif
   filesys_done ();
 #endif
 
@@ -120,6 +127,9 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  palloc_print_stats ();
+  malloc_print_stats ();
+  slab_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
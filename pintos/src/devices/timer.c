@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -20,6 +21,19 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* A thread sleeping in timer_sleep(). */
+struct sleeper
+  {
+    struct list_elem elem;      /* Element in sleep_list. */
+    int64_t wake;               /* Tick at which to wake. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+  };
+
+/* Threads sleeping in timer_sleep(), in order of waking time.
+   Accessed with interrupts off, since the timer interrupt wakes
+   them. */
+static struct list sleep_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,12 +43,15 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool wakes_earlier (const struct list_elem *,
+                           const struct list_elem *, void *aux);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -85,15 +102,34 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread blocks until the timer interrupt
+   wakes it, so it takes no CPU time while asleep. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct sleeper s;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  sema_init (&s.sema, 0);
+  old_level = intr_disable ();
+  s.wake = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &s.elem, wakes_earlier, NULL);
+  intr_set_level (old_level);
+
+  sema_down (&s.sema);
+}
+
+/* Returns true if sleeper A wakes before sleeper B. */
+static bool
+wakes_earlier (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED) 
+{
+  return (list_entry (a, struct sleeper, elem)->wake
+          < list_entry (b, struct sleeper, elem)->wake);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -171,6 +207,15 @@ static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
+  while (!list_empty (&sleep_list))
+    {
+      struct sleeper *s = list_entry (list_front (&sleep_list),
+                                      struct sleeper, elem);
+      if (s->wake > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      sema_up (&s->sema);
+    }
   thread_tick ();
 }
 
@@ -1,54 +1,182 @@
-/* cat.c
+/* cp.c
 
-Copies one file to another. */
+   Copies one file to another.
 
+   The copy is made with copy_file_range(), which moves the data
+   inside the kernel.  With -b, cp also times copying through a
+   user buffer with read() and write(), the way it used to, and
+   prints the CPU cycles each method took.  Times are taken from
+   the CPU's time-stamp counter. */
+
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall.h>
 
+/* Size of the user buffer for copying with read() and
+   write(). */
+#define BUF_SIZE 1024
+
+/* A way of copying a file: copies all of IN_FD to OUT_FD, both
+   at position 0, and returns the number of system calls it made,
+   or -1 on failure. */
+typedef int copy_func (int in_fd, int out_fd);
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Copies through a user buffer. */
+static int
+copy_read_write (int in_fd, int out_fd)
+{
+  static char buffer[BUF_SIZE];
+  int calls = 0;
+
+  for (;;)
+    {
+      int bytes_read = read (in_fd, buffer, sizeof buffer);
+      calls++;
+      if (bytes_read == 0)
+        return calls;
+      calls++;
+      if (bytes_read < 0 || write (out_fd, buffer, bytes_read) != bytes_read)
+        return -1;
+    }
+}
+
+/* Copies inside the kernel. */
+static int
+copy_in_kernel (int in_fd, int out_fd)
+{
+  int calls = 0;
+
+  for (;;)
+    {
+      int bytes_copied = copy_file_range (in_fd, out_fd, 65536);
+      calls++;
+      if (bytes_copied == 0)
+        return calls;
+      if (bytes_copied < 0)
+        return -1;
+    }
+}
+
+/* Creates NEW with the size of IN_FD's file and copies IN_FD into
+   it with METHOD.  Stores the cycles taken into *CYCLES and the
+   number of system calls into *CALLS.  Returns true if
+   successful, false on failure after printing a message. */
+static bool
+copy (int in_fd, const char *new, copy_func *method, uint64_t *cycles,
+      int *calls)
+{
+  uint64_t start;
+  int out_fd;
+
+  if (!create (new, filesize (in_fd)))
+    {
+      printf ("%s: create failed\n", new);
+      return false;
+    }
+  out_fd = open (new);
+  if (out_fd < 0)
+    {
+      printf ("%s: open failed\n", new);
+      return false;
+    }
+
+  seek (in_fd, 0);
+  start = rdtsc ();
+  *calls = method (in_fd, out_fd);
+  *cycles = rdtsc () - start;
+  close (out_fd);
+
+  if (*calls < 0)
+    {
+      printf ("%s: write failed\n", new);
+      return false;
+    }
+  return true;
+}
+
+/* Returns true if the files open as A_FD and B_FD, from their
+   current positions, have the same contents. */
+static bool
+same_contents (int a_fd, int b_fd)
+{
+  static char a[BUF_SIZE], b[BUF_SIZE];
+
+  for (;;)
+    {
+      int a_cnt = read (a_fd, a, sizeof a);
+      int b_cnt = read (b_fd, b, sizeof b);
+      if (a_cnt != b_cnt || memcmp (a, b, a_cnt))
+        return false;
+      if (a_cnt == 0)
+        return true;
+    }
+}
+
 int
-main (int argc, char *argv[]) 
+main (int argc, char *argv[])
 {
+  bool bench = argc == 4 && !strcmp (argv[1], "-b");
+  const char *old, *new;
+  uint64_t rw_cycles, kernel_cycles;
+  int rw_calls, kernel_calls;
   int in_fd, out_fd;
 
-  if (argc != 3) 
+  if (argc != 3 && !bench)
     {
-      printf ("usage: cp OLD NEW\n");
+      printf ("usage: cp [-b] OLD NEW\n");
       return EXIT_FAILURE;
     }
+  old = argv[argc - 2];
+  new = argv[argc - 1];
 
   /* Open input file. */
-  in_fd = open (argv[1]);
-  if (in_fd < 0) 
+  in_fd = open (old);
+  if (in_fd < 0)
     {
-      printf ("%s: open failed\n", argv[1]);
+      printf ("%s: open failed\n", old);
       return EXIT_FAILURE;
     }
 
-  /* Create and open output file. */
-  if (!create (argv[2], filesize (in_fd))) 
-    {
-      printf ("%s: create failed\n", argv[2]);
-      return EXIT_FAILURE;
-    }
-  out_fd = open (argv[2]);
-  if (out_fd < 0) 
+  if (bench)
     {
-      printf ("%s: open failed\n", argv[2]);
-      return EXIT_FAILURE;
+      if (!copy (in_fd, new, copy_read_write, &rw_cycles, &rw_calls))
+        return EXIT_FAILURE;
+      remove (new);
     }
 
-  /* Copy data. */
-  for (;;) 
+  if (!copy (in_fd, new, copy_in_kernel, &kernel_cycles, &kernel_calls))
+    return EXIT_FAILURE;
+
+  if (bench)
     {
-      char buffer[1024];
-      int bytes_read = read (in_fd, buffer, sizeof buffer);
-      if (bytes_read == 0)
-        break;
-      if (write (out_fd, buffer, bytes_read) != bytes_read) 
+      unsigned speedup = kernel_cycles > 0
+                         ? rw_cycles * 100 / kernel_cycles : 0;
+
+      out_fd = open (new);
+      seek (in_fd, 0);
+      if (out_fd < 0 || !same_contents (in_fd, out_fd))
         {
-          printf ("%s: write failed\n", argv[2]);
+          printf ("%s: copy differs from %s\n", new, old);
           return EXIT_FAILURE;
         }
+
+      printf ("%-16s %8s %14s\n", "method", "syscalls", "cycles");
+      printf ("%-16s %8d %14llu\n", "read/write", rw_calls,
+              (unsigned long long) rw_cycles);
+      printf ("%-16s %8d %14llu\n", "copy_file_range", kernel_calls,
+              (unsigned long long) kernel_cycles);
+      printf ("copy_file_range speedup: %u.%02ux (%d bytes)\n",
+              speedup / 100, speedup % 100, filesize (in_fd));
     }
 
   return EXIT_SUCCESS;
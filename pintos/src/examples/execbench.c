@@ -0,0 +1,87 @@
+/* execbench.c
+
+   Measures how long exec() and wait() take to run a program that
+   exits at once, given 0, 16, 128, and 512 arguments, so that the
+   cost of passing arguments to the new process shows up against
+   the cost of starting it at all.  Times are taken from the CPU's
+   time-stamp counter, so they are in CPU cycles, not wall-clock
+   time.
+
+   The program runs itself as the child; a child gets "-c" as its
+   first argument. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Number of times each measurement is repeated. */
+#define RUNS 20
+
+/* Most arguments measured. */
+#define MAX_ARGS 512
+
+/* Command line, kept out of the stack because it can be larger
+   than a page. */
+static char cmdline[MAX_ARGS * 8 + 32];
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Builds a command line for a child with ARG_CNT arguments after
+   the "-c" that marks it as one. */
+static void
+make_cmdline (int arg_cnt)
+{
+  size_t ofs = strlcpy (cmdline, "execbench -c", sizeof cmdline);
+  int i;
+
+  for (i = 0; i < arg_cnt; i++)
+    ofs += snprintf (cmdline + ofs, sizeof cmdline - ofs, " arg%d", i);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const int arg_cnts[] = {0, 16, 128, MAX_ARGS};
+  size_t i;
+
+  /* A child exits with the number of arguments it was given, so
+     that the parent can check they all arrived. */
+  if (argc > 1 && !strcmp (argv[1], "-c"))
+    return argc - 2;
+
+  printf ("%8s %8s %14s\n", "args", "bytes", "cycles/exec");
+  for (i = 0; i < sizeof arg_cnts / sizeof *arg_cnts; i++)
+    {
+      uint64_t best = UINT64_MAX;
+      int run;
+
+      make_cmdline (arg_cnts[i]);
+      for (run = 0; run < RUNS; run++)
+        {
+          uint64_t start = rdtsc ();
+          pid_t pid = exec (cmdline);
+          int status = wait (pid);
+          uint64_t cycles = rdtsc () - start;
+
+          if (pid == PID_ERROR || status != arg_cnts[i])
+            {
+              printf ("execbench: child with %d arguments failed\n",
+                      arg_cnts[i]);
+              return EXIT_FAILURE;
+            }
+          if (cycles < best)
+            best = cycles;
+        }
+      printf ("%8d %8zu %14llu\n", arg_cnts[i], strlen (cmdline),
+              (unsigned long long) best);
+    }
+  return EXIT_SUCCESS;
+}
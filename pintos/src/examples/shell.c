@@ -3,8 +3,12 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -31,19 +35,76 @@ main (void)
           /* Empty command. */
         }
       else
-        {
-          pid_t pid = exec (command);
-          if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
-        }
+        run_pipeline (command);
     }
 
   printf ("Shell exiting.");
   return EXIT_SUCCESS;
 }
 
+/* Runs COMMAND, which may be a pipeline of commands separated by
+   `|', each of which reads the output of the one before it.  All
+   the commands are started before any is waited for, so that
+   data can flow through the pipes as it is produced.  Prints each
+   command's exit code. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int prev_read = -1;
+  char *stage, *save_ptr;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      if (stage_cnt == MAX_STAGES)
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = stage;
+    }
+
+  for (i = 0; i < stage_cnt; i++)
+    {
+      int fds[2] = {-1, -1};
+
+      if (i < stage_cnt - 1 && pipe (fds) < 0)
+        printf ("pipe failed\n");
+
+      /* The child takes over our standard input and output, so
+         point them at the pipes while it starts and then put them
+         back. */
+      if (prev_read >= 0)
+        dup2 (prev_read, STDIN_FILENO);
+      if (fds[1] >= 0)
+        dup2 (fds[1], STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+      close (STDIN_FILENO);
+      close (STDOUT_FILENO);
+
+      /* Only the children should hold the pipes open, so that
+         each reader sees end of file when its writer exits. */
+      if (prev_read >= 0)
+        close (prev_read);
+      if (fds[1] >= 0)
+        close (fds[1]);
+      prev_read = fds[0];
+
+      if (pids[i] == PID_ERROR)
+        printf ("exec failed\n");
+    }
+  if (prev_read >= 0)
+    close (prev_read);
+
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
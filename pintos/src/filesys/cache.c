@@ -0,0 +1,255 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <ohash.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Buffer cache.
+
+   Keeps the CACHE_SIZE most recently used sectors of the file
+   system device in memory.  Reads are served from the cache when
+   possible, and writes only update the cached copy, which is
+   written back to disk when the sector is evicted or by
+   cache_flush().  Several writes to one sector, such as a run of
+   updates to a single inode, therefore cost one disk write.
+
+   A sector written with cache_write_pinned() is pinned: it is
+   neither evicted nor written back until cache_unpin().  The
+   metadata log (see log.c) pins the sectors that belong to the
+   running transaction, so that they cannot reach their home
+   locations on disk before the transaction commits.  The log
+   never pins more than half the cache.
+
+   Eviction uses the clock algorithm.  A single lock protects the
+   whole cache and is held across disk I/O, which is simple and
+   adequate while the file system is used by one thread at a
+   time. */
+
+/* Number of sectors in the cache. */
+#define CACHE_SIZE 64
+
+/* A cached sector. */
+struct cache_entry
+  {
+    block_sector_t sector;      /* Sector number, if IN_USE. */
+    bool in_use;                /* Holds a sector? */
+    bool dirty;                 /* Modified since read or written? */
+    bool accessed;              /* Used since clock hand passed? */
+    bool pinned;                /* Held in place by the log? */
+    uint8_t *data;              /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+static struct cache_entry entries[CACHE_SIZE];
+static struct ohash sector_map; /* Maps a sector to its entry. */
+static struct lock cache_lock;  /* Protects all of the above. */
+static size_t clock_hand;       /* Next entry to consider evicting. */
+
+static struct cache_entry *get_entry (block_sector_t, bool read);
+static void write_back (struct cache_entry *);
+
+/* Initializes the buffer cache. */
+void
+cache_init (void) 
+{
+  uint8_t *data;
+  size_t i;
+
+  data = palloc_get_multiple (PAL_ASSERT,
+                              CACHE_SIZE * BLOCK_SECTOR_SIZE / PGSIZE);
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      entries[i].in_use = false;
+      entries[i].data = data + i * BLOCK_SECTOR_SIZE;
+    }
+  if (!ohash_init (&sector_map))
+    PANIC ("can't allocate buffer cache");
+  lock_init (&cache_lock);
+  clock_hand = 0;
+}
+
+/* Writes every modified sector back to disk. */
+void
+cache_done (void) 
+{
+  cache_flush ();
+}
+
+/* Copies SIZE bytes starting at offset OFS in SECTOR into
+   BUFFER. */
+void
+cache_read_at (block_sector_t sector, void *buffer, size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, true);
+  memcpy (buffer, e->data + ofs, size);
+  lock_release (&cache_lock);
+}
+
+/* Copies SIZE bytes from BUFFER into SECTOR, starting at offset
+   OFS.  If the write covers the whole sector, the sector is not
+   read from disk first. */
+void
+cache_write_at (block_sector_t sector, const void *buffer,
+                size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, ofs != 0 || size != BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  lock_release (&cache_lock);
+}
+
+/* Like cache_write_at(), but also pins SECTOR in the cache until
+   cache_unpin() is called for it.  Returns true if SECTOR was not
+   already pinned. */
+bool
+cache_write_pinned (block_sector_t sector, const void *buffer,
+                    size_t ofs, size_t size)
+{
+  struct cache_entry *e;
+  bool was_pinned;
+
+  ASSERT (ofs + size <= BLOCK_SECTOR_SIZE);
+
+  lock_acquire (&cache_lock);
+  e = get_entry (sector, ofs != 0 || size != BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  was_pinned = e->pinned;
+  e->pinned = true;
+  lock_release (&cache_lock);
+
+  return !was_pinned;
+}
+
+/* Unpins SECTOR, which must be cached and pinned, so that it may
+   be written back and evicted again. */
+void
+cache_unpin (block_sector_t sector) 
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = ohash_find (&sector_map, sector);
+  ASSERT (e != NULL && e->pinned);
+  e->pinned = false;
+  lock_release (&cache_lock);
+}
+
+/* Drops SECTOR from the cache without writing it back, if it is
+   cached and not pinned.  Used for sectors that are being freed,
+   whose contents no longer matter. */
+void
+cache_discard (block_sector_t sector) 
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = ohash_find (&sector_map, sector);
+  if (e != NULL && !e->pinned)
+    {
+      ohash_delete (&sector_map, sector);
+      e->in_use = false;
+    }
+  lock_release (&cache_lock);
+}
+
+/* Writes every modified sector that is not pinned back to
+   disk. */
+void
+cache_flush (void) 
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (entries[i].in_use && entries[i].dirty && !entries[i].pinned)
+      write_back (&entries[i]);
+  lock_release (&cache_lock);
+}
+
+/* Writes the modified sectors among the CNT starting at START
+   back to disk, except those that are pinned. */
+void
+cache_flush_range (block_sector_t start, size_t cnt) 
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (entries[i].in_use && entries[i].dirty && !entries[i].pinned
+        && entries[i].sector - start < cnt)
+      write_back (&entries[i]);
+  lock_release (&cache_lock);
+}
+
+/* Returns the entry for SECTOR, loading it into the cache if
+   necessary.  When a sector is loaded, it is read from disk if
+   READ is true; otherwise the caller must overwrite all of it. */
+static struct cache_entry *
+get_entry (block_sector_t sector, bool read) 
+{
+  struct cache_entry *e;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  e = ohash_find (&sector_map, sector);
+  if (e != NULL)
+    {
+      e->accessed = true;
+      return e;
+    }
+
+  /* Pick a victim: the first entry the clock hand reaches that
+     is free or has not been used since the hand last passed,
+     skipping pinned entries. */
+  for (;;)
+    {
+      e = &entries[clock_hand];
+      clock_hand = (clock_hand + 1) % CACHE_SIZE;
+      if (!e->in_use)
+        break;
+      if (e->pinned)
+        continue;
+      if (!e->accessed)
+        {
+          if (e->dirty)
+            write_back (e);
+          ohash_delete (&sector_map, e->sector);
+          break;
+        }
+      e->accessed = false;
+    }
+
+  e->sector = sector;
+  e->in_use = true;
+  e->dirty = false;
+  e->accessed = true;
+  e->pinned = false;
+  if (ohash_insert (&sector_map, sector, e) != NULL)
+    PANIC ("can't allocate buffer cache");
+  if (read)
+    block_read (fs_device, sector, e->data);
+  return e;
+}
+
+/* Writes E, which must be in use, back to disk. */
+static void
+write_back (struct cache_entry *e) 
+{
+  block_write (fs_device, e->sector, e->data);
+  e->dirty = false;
+}
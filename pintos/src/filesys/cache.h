@@ -0,0 +1,20 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+void cache_init (void);
+void cache_done (void);
+
+void cache_read_at (block_sector_t, void *, size_t ofs, size_t size);
+void cache_write_at (block_sector_t, const void *, size_t ofs, size_t size);
+bool cache_write_pinned (block_sector_t, const void *, size_t ofs,
+                         size_t size);
+void cache_unpin (block_sector_t);
+void cache_discard (block_sector_t);
+void cache_flush (void);
+void cache_flush_range (block_sector_t start, size_t cnt);
+
+#endif /* filesys/cache.h */
@@ -1,7 +1,9 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file 
@@ -11,13 +13,23 @@ struct file
     bool deny_write;            /* Has file_deny_write() been called? */
 };
 
+/* Cache of open files. */
+static struct slab_cache file_cache;
+
+/* Initializes the file module. */
+    void
+file_init (void) 
+{
+    slab_cache_init (&file_cache, "file", sizeof (struct file), 0, NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
     struct file *
 file_open (struct inode *inode) 
 {
-    struct file *file = calloc (1, sizeof *file);
+    struct file *file = slab_alloc (&file_cache);
     if (inode != NULL && file != NULL)
     {
         file->inode = inode;
@@ -28,7 +40,7 @@ file_open (struct inode *inode)
     else
     {
         inode_close (inode);
-        free (file);
+        slab_free (&file_cache, file);
         return NULL; 
     }
 }
@@ -49,7 +61,7 @@ file_close (struct file *file)
     {
         file_allow_write (file);
         inode_close (file->inode);
-        free (file); 
+        slab_free (&file_cache, file); 
     }
 }
 
@@ -113,6 +125,53 @@ file_write_at (struct file *file, const void *buffer, off_t size,
     return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, into DST at its current position, without passing
+   the data through user memory.  Returns the number of bytes
+   actually copied, which may be less than SIZE if the end of
+   either file is reached or memory is short.  Advances both
+   files' positions by the number of bytes copied.
+
+   Data moves a page at a time.  The first chunk stops at a
+   sector boundary in DST, so that every later chunk overwrites
+   whole sectors, which the buffer cache writes without reading
+   them first. */
+    off_t
+file_copy (struct file *dst, struct file *src, off_t size) 
+{
+    uint8_t *buffer;
+    off_t bytes_copied = 0;
+
+    ASSERT (dst != NULL);
+    ASSERT (src != NULL);
+
+    buffer = palloc_get_page (0);
+    if (buffer == NULL)
+        return 0;
+
+    while (bytes_copied < size) 
+    {
+        off_t chunk = PGSIZE - dst->pos % BLOCK_SECTOR_SIZE;
+        off_t bytes_read, bytes_written;
+
+        if (chunk > size - bytes_copied)
+            chunk = size - bytes_copied;
+        bytes_read = inode_read_at (src->inode, buffer, chunk, src->pos);
+        if (bytes_read == 0)
+            break;
+        bytes_written = inode_write_at (dst->inode, buffer, bytes_read,
+                                        dst->pos);
+        src->pos += bytes_written;
+        dst->pos += bytes_written;
+        bytes_copied += bytes_written;
+        if (bytes_written < bytes_read)
+            break;
+    }
+
+    palloc_free_page (buffer);
+    return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
     void
@@ -148,6 +207,14 @@ file_length (struct file *file)
     return inode_length (file->inode);
 }
 
+/* Writes FILE's modified data and metadata to disk. */
+    void
+file_sync (struct file *file) 
+{
+    ASSERT (file != NULL);
+    inode_flush (file->inode);
+}
+
 /* Sets the current position in FILE to NEW_POS bytes from the
    start of the file. */
     void
@@ -2,10 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/log.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -21,7 +23,11 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
+  log_init (format);
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -35,7 +41,12 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  /* Commit first, so that the free map written out below
+     includes the sectors released by the last transaction. */
+  log_sync ();
   free_map_close ();
+  log_done ();
+  cache_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -46,14 +57,19 @@ bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir;
+  bool success;
+
+  log_begin ();
+  dir = dir_open_root ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && inode_create (inode_sector, initial_size, false)
+             && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  log_end ();
 
   return success;
 }
@@ -83,21 +99,36 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
-  dir_close (dir); 
+  struct dir *dir;
+  bool success;
+
+  log_begin ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
+  dir_close (dir);
+  log_end (); 
 
   return success;
 }
 
+/* Writes all modified file data and metadata to disk. */
+void
+filesys_sync (void) 
+{
+  log_sync ();
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  log_begin ();
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  log_end ();
   free_map_close ();
+  log_sync ();
   printf ("done.\n");
 }
@@ -1,13 +1,31 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/log.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 
+/* Sectors of the free map file that have changed since they were
+   last written, one bit per sector.  Allocation and release only
+   mark sectors here; free_map_flush() writes them out, so many
+   changes to one part of the free map cost a single write. */
+static struct bitmap *dirty_sectors;
+
+/* Sectors released by the running transaction.  They stay
+   allocated in FREE_MAP until it commits, so that a sector freed
+   by an operation that has not yet committed to the log cannot
+   be reused, and overwritten, by a later one, and so that the
+   free map written before the commit point never shows them
+   free. */
+static struct bitmap *released;
+
+static void mark_dirty (block_sector_t, size_t cnt);
+
 /* Initializes the free map. */
 void
 free_map_init (void) 
@@ -17,36 +35,91 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, LOG_SECTOR, LOG_SECTOR_CNT, true);
+
+  dirty_sectors = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                               BLOCK_SECTOR_SIZE));
+  released = bitmap_create (block_size (fs_device));
+  if (dirty_sectors == NULL || released == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.  The change reaches the disk at the
+   next free_map_flush(). */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
   block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      mark_dirty (sector, cnt);
+      *sectorp = sector;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use, as of
+   the next free_map_commit().  The change reaches the disk at the
+   free_map_flush() after that. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  ASSERT (bitmap_none (released, sector, cnt));
+  bitmap_set_multiple (released, sector, cnt, true);
+  mark_dirty (sector, cnt);
+}
+
+/* Writes the parts of the free map that have changed since they
+   were last written to disk.  Runs of adjacent changed sectors
+   are written together.  The free map file is not logged, so
+   this goes to disk with the next cache flush.  Returns true if
+   successful, false if some sector could not be written, in
+   which case it stays marked for the next attempt. */
+bool
+free_map_flush (void)
+{
+  size_t sector_cnt = bitmap_size (dirty_sectors);
+  size_t start = 0;
+  bool success = true;
+
+  if (free_map_file == NULL)
+    return true;
+
+  while ((start = bitmap_scan (dirty_sectors, start, 1, true))
+         != BITMAP_ERROR)
+    {
+      size_t end = bitmap_scan (dirty_sectors, start, 1, false);
+      if (end == BITMAP_ERROR)
+        end = sector_cnt;
+
+      if (bitmap_write_range (free_map, free_map_file,
+                              start * BLOCK_SECTOR_SIZE,
+                              (end - start) * BLOCK_SECTOR_SIZE))
+        bitmap_set_multiple (dirty_sectors, start, end - start, false);
+      else
+        success = false;
+      start = end;
+    }
+  return success;
+}
+
+/* Frees the sectors released by the transaction that has just
+   committed.  Called by the log after the commit point. */
+void
+free_map_commit (void)
+{
+  size_t start = 0;
+
+  while ((start = bitmap_scan_and_flip (released, start, 1, true))
+         != BITMAP_ERROR)
+    {
+      bitmap_reset (free_map, start);
+      mark_dirty (start, 1);
+    }
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -64,7 +137,10 @@ free_map_open (void)
 void
 free_map_close (void) 
 {
+  if (!free_map_flush ())
+    PANIC ("can't write free map");
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -73,7 +149,7 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
@@ -82,4 +158,21 @@ free_map_create (void)
     PANIC ("can't open free map");
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty_sectors, false);
+}
+
+/* Marks the free map file sectors that hold the bits for the CNT
+   sectors starting at SECTOR as changed. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first, last;
+
+  if (cnt == 0)
+    return;
+
+  /* Bit K of the free map is in byte K / 8 of its file. */
+  first = sector / 8 / BLOCK_SECTOR_SIZE;
+  last = (sector + cnt - 1) / 8 / BLOCK_SECTOR_SIZE;
+  bitmap_set_multiple (dirty_sectors, first, last - first + 1, true);
 }
@@ -2,22 +2,68 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stddef.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/log.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
-/* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
-struct inode_disk
+/* Largest file whose data is kept inside its inode sector. */
+#define INODE_INLINE_MAX 480
+
+/* Inode flags. */
+#define INODE_INLINE 0x1                /* Data is in INLINE_DATA. */
+#define INODE_META 0x2                  /* Data is file system metadata. */
+
+/* Fixed fields at the start of an on-disk inode.  An open inode
+   keeps a copy of these; the rest of the inode sector, including
+   any inline data, is only accessed through the buffer cache.
+
+   A file of up to INODE_INLINE_MAX bytes has no data sectors at
+   all: its data lives in INLINE_DATA, so it takes one sector on
+   disk instead of two and is read along with its inode.
+
+   Data sectors are not zeroed when they are allocated.  Instead,
+   WRITTEN_CNT counts the leading data sectors that have been
+   written; the sectors after them read as zeros without touching
+   the disk.  A write beyond WRITTEN_CNT first zeroes any sectors
+   it skips over, so every sector below WRITTEN_CNT always holds
+   real data.
+
+   A single count is cheap to keep in the inode, but it only
+   avoids zeroing for files written from the start onward.  A
+   write far past WRITTEN_CNT still zeroes every sector in
+   between, synchronously, as part of that write: for such
+   writes the cost of zeroing moves from inode_create() to the
+   write rather than going away.
+
+   The inode sector itself, and the data of files flagged
+   INODE_META (directories), are written through the metadata
+   log.  Other file data, including the free map, is not
+   logged. */
+struct inode_meta
   {
     block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t written_cnt;               /* Data sectors written so far. */
+    uint32_t flags;                     /* INODE_* flags. */
+  };
+
+/* On-disk inode.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct inode_disk
+  {
+    struct inode_meta meta;             /* Fixed fields. */
+    uint8_t inline_data[INODE_INLINE_MAX]; /* Data, if INODE_INLINE. */
+    uint32_t unused[3];                 /* Not used. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -36,7 +82,8 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
-    struct inode_disk data;             /* Inode content. */
+    unsigned version;                   /* Incremented by every write. */
+    struct inode_meta meta;             /* Copy of on-disk fixed fields. */
   };
 
 /* Returns the block device sector that contains byte offset POS
@@ -47,30 +94,52 @@ static block_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) 
 {
   ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
+  if (pos < inode->meta.length)
+    return inode->meta.start + pos / BLOCK_SECTOR_SIZE;
   else
     return -1;
 }
 
+static off_t write_at (struct inode *, const uint8_t *, off_t size,
+                       off_t offset);
+static void data_write_at (struct inode *, block_sector_t, const void *,
+                           size_t ofs, size_t size);
+static off_t inline_io (struct inode *, void *, off_t size, off_t offset,
+                        bool write);
+static void zero_fill (struct inode *, size_t sector_cnt);
+static void set_written_cnt (struct inode *, uint32_t);
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and each open inode's open_cnt, removed,
+   and deny_write_cnt.  Programs are loaded without the system
+   call layer's file lock, several at a time, so opening and
+   closing cannot rely on it. */
+static struct lock open_lock;
+
+/* Cache of in-memory inodes. */
+static struct slab_cache inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_lock);
+  slab_cache_init (&inode_cache, "inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  IS_META should be true if the inode's data is file
+   system metadata, such as a directory, whose writes must be
+   logged.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_meta)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -85,19 +154,20 @@ inode_create (block_sector_t sector, off_t length)
   if (disk_inode != NULL)
     {
       size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
+      disk_inode->meta.length = length;
+      disk_inode->meta.magic = INODE_MAGIC;
+      disk_inode->meta.flags = is_meta ? INODE_META : 0;
+      if (length <= INODE_INLINE_MAX)
+        {
+          disk_inode->meta.flags |= INODE_INLINE;
+          log_write_at (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
+          success = true;
+        }
+      else if (free_map_allocate (sectors, &disk_inode->meta.start)) 
         {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
+          /* The data sectors read as zeros until written, so
+             there is no need to clear them here. */
+          log_write_at (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
           success = true; 
         } 
       free (disk_inode);
@@ -114,6 +184,8 @@ inode_open (block_sector_t sector)
   struct list_elem *e;
   struct inode *inode;
 
+  lock_acquire (&open_lock);
+
   /* Check whether this inode is already open. */
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
@@ -121,23 +193,29 @@ inode_open (block_sector_t sector)
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_lock);
           return inode; 
         }
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (&inode_cache);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize, and only then let other openers find it. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->version = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  cache_read_at (inode->sector, &inode->meta, 0, sizeof inode->meta);
+  list_push_front (&open_inodes, &inode->elem);
+  lock_release (&open_lock);
   return inode;
 }
 
@@ -146,7 +224,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_lock);
+      inode->open_cnt++;
+      lock_release (&open_lock);
+    }
   return inode;
 }
 
@@ -157,7 +239,7 @@ inode_get_inumber (const struct inode *inode)
   return inode->sector;
 }
 
-/* Closes INODE and writes it to disk.
+/* Closes INODE.
    If this was the last reference to INODE, frees its memory.
    If INODE was also a removed inode, frees its blocks. */
 void
@@ -168,20 +250,36 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  lock_acquire (&open_lock);
+  if (--inode->open_cnt > 0)
+    lock_release (&open_lock);
+  else
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      lock_release (&open_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          uint32_t i;
+
+          log_begin ();
+
+          /* No need to write back sectors that are being freed. */
+          cache_discard (inode->sector);
+          for (i = 0; i < inode->meta.written_cnt; i++)
+            cache_discard (inode->meta.start + i);
+
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          if (!(inode->meta.flags & INODE_INLINE))
+            free_map_release (inode->meta.start,
+                              bytes_to_sectors (inode->meta.length)); 
+
+          log_end ();
         }
 
-      free (inode); 
+      slab_free (&inode_cache, inode); 
     }
 }
 
@@ -191,7 +289,17 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  lock_acquire (&open_lock);
   inode->removed = true;
+  lock_release (&open_lock);
+}
+
+/* Returns true if INODE has been removed, so that it will be
+   deleted when it is last closed. */
+bool
+inode_is_removed (const struct inode *inode) 
+{
+  return inode->removed;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -202,7 +310,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+
+  if (inode->meta.flags & INODE_INLINE)
+    return inline_io (inode, buffer_, size, offset, false);
 
   while (size > 0) 
     {
@@ -220,31 +330,20 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_idx - inode->meta.start >= inode->meta.written_cnt)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Never written, so it reads as zeros. */
+          memset (buffer + bytes_read, 0, chunk_size);
         }
+      else
+        cache_read_at (sector_idx, buffer + bytes_read, sector_ofs,
+                       chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
 
   return bytes_read;
 }
@@ -255,16 +354,35 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
    (Normally a write at end of file would extend the inode, but
    growth is not yet implemented.) */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset) 
 {
-  const uint8_t *buffer = buffer_;
-  off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  off_t bytes_written;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  log_begin ();
+  if (inode->meta.flags & INODE_INLINE)
+    bytes_written = inline_io (inode, (void *) buffer, size, offset, true);
+  else
+    bytes_written = write_at (inode, buffer, size, offset);
+  if (bytes_written > 0)
+    inode->version++;
+  log_end ();
+
+  return bytes_written;
+}
+
+/* Writes SIZE bytes from BUFFER into the data sectors of INODE,
+   starting at OFFSET.  Returns the number of bytes actually
+   written. */
+static off_t
+write_at (struct inode *inode, const uint8_t *buffer, off_t size,
+          off_t offset) 
+{
+  off_t bytes_written = 0;
+
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -278,41 +396,30 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       /* Number of bytes to actually write into this sector. */
       int chunk_size = size < min_left ? size : min_left;
+      size_t sector_cnt;
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      /* Zero any unwritten sectors that this write skips over,
+         and this one too if it has never been written and the
+         write does not cover all of it, since it must read as
+         zeros around the chunk. */
+      sector_cnt = sector_idx - inode->meta.start;
+      if (chunk_size < BLOCK_SECTOR_SIZE)
+        zero_fill (inode, sector_cnt + 1);
+      else
+        zero_fill (inode, sector_cnt);
+
+      data_write_at (inode, sector_idx, buffer + bytes_written, sector_ofs,
+                     chunk_size);
+      if (inode->meta.written_cnt == sector_cnt)
+        set_written_cnt (inode, sector_cnt + 1);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
   return bytes_written;
 }
@@ -322,8 +429,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  lock_acquire (&open_lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  lock_release (&open_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,14 +441,104 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  lock_acquire (&open_lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  lock_release (&open_lock);
+}
+
+/* Returns INODE's version number, which changes whenever data is
+   written to INODE.  Someone who keeps INODE open and remembers
+   its version can tell later whether its contents may have
+   changed. */
+unsigned
+inode_version (const struct inode *inode)
+{
+  return inode->version;
 }
 
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  return inode->meta.length;
+}
+
+/* Writes INODE's modified data sectors to disk and commits any
+   pending change to its inode or to other metadata, so that
+   everything written to INODE so far survives a crash.  A file
+   stored inline has no data sectors of its own: its data is
+   committed with its inode. */
+void
+inode_flush (struct inode *inode) 
+{
+  if (!(inode->meta.flags & (INODE_INLINE | INODE_META)))
+    cache_flush_range (inode->meta.start, inode->meta.written_cnt);
+  log_commit ();
+}
+
+/* Copies SIZE bytes from BUFFER into data sector SECTOR of
+   INODE, starting at offset OFS, through the log if INODE holds
+   metadata. */
+static void
+data_write_at (struct inode *inode, block_sector_t sector,
+               const void *buffer, size_t ofs, size_t size)
+{
+  if (inode->meta.flags & INODE_META)
+    log_write_at (sector, buffer, ofs, size);
+  else
+    cache_write_at (sector, buffer, ofs, size);
+}
+
+/* Copies up to SIZE bytes between BUFFER and the inline data of
+   INODE, starting at OFFSET, stopping at end of file.  Copies
+   from BUFFER to INODE if WRITE is true, and the other way
+   otherwise.  Returns the number of bytes copied. */
+static off_t
+inline_io (struct inode *inode, void *buffer, off_t size, off_t offset,
+           bool write)
+{
+  off_t length = inode->meta.length;
+  size_t ofs = offsetof (struct inode_disk, inline_data) + offset;
+
+  if (offset >= length)
+    return 0;
+  if (size > length - offset)
+    size = length - offset;
+
+  if (write)
+    log_write_at (inode->sector, buffer, ofs, size);
+  else
+    cache_read_at (inode->sector, buffer, ofs, size);
+  return size;
+}
+
+/* Writes zeros to each of the first SECTOR_CNT data sectors of
+   INODE that has not yet been written.  This can be the whole gap
+   between the last sector written and SECTOR_CNT; see the
+   comment on struct inode_meta. */
+static void
+zero_fill (struct inode *inode, size_t sector_cnt)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  uint32_t written_cnt = inode->meta.written_cnt;
+
+  if (written_cnt >= sector_cnt)
+    return;
+  for (; written_cnt < sector_cnt; written_cnt++)
+    data_write_at (inode, inode->meta.start + written_cnt, zeros,
+                   0, BLOCK_SECTOR_SIZE);
+  set_written_cnt (inode, written_cnt);
+}
+
+/* Sets INODE's count of written data sectors to WRITTEN_CNT, in
+   memory and in its on-disk inode. */
+static void
+set_written_cnt (struct inode *inode, uint32_t written_cnt)
+{
+  inode->meta.written_cnt = written_cnt;
+  log_write_at (inode->sector, &written_cnt,
+                  offsetof (struct inode_meta, written_cnt),
+                  sizeof written_cnt);
 }
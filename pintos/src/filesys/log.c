@@ -0,0 +1,362 @@
+#include "filesys/log.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Write-ahead metadata log.
+
+   File system metadata (inodes and directories) is written
+   through log_write_at() instead of directly to the buffer
+   cache.  Such writes join the running transaction, and the
+   cache keeps the sectors they touch pinned in memory until the
+   transaction commits.  Ordinary file data is not logged, but
+   sectors freed by a transaction are not reused until it commits
+   (see free_map_release()), so a crash cannot leave a committed
+   file pointing at another file's data.
+
+   The free map is not logged either, since on a large device it
+   could not fit in the log.  Instead, each commit writes it home
+   ahead of the commit point with the transaction's allocations
+   but not its releases, which are applied only afterward.  A
+   crash can then leave sectors marked in use that nothing uses,
+   but never the reverse.
+
+   Committing a transaction writes the free map and all other
+   unpinned dirty sectors home (so that file data reaches the
+   disk before any inode that covers it), copies the logged
+   sectors into the log area, and then writes the log header,
+   which is the commit point.  Only then are the logged sectors
+   unpinned and written home, after which the header is cleared
+   and the transaction's released sectors become free.  If the
+   machine stops at any point, log_init() finds either an empty
+   log, in which case none of the transaction reached its home
+   sectors, or a full one, which it replays.
+
+   Operations that modify metadata are bracketed by log_begin()
+   and log_end().  Operations nest, and a transaction may hold
+   any number of them: commits are batched, happening only when
+   the log has no room for another operation, when log_sync() or
+   log_commit() is called, or every FLUSH_INTERVAL timer ticks.
+   Each operation in progress reserves room for MAX_OP_SECTORS
+   sectors, and FREE_MAP_SECTORS more are always kept for a free
+   map small enough to live inside its inode, which is then
+   logged along with the inode at commit.  An operation
+   that would not fit waits in log_begin() for the operations in
+   progress to finish, and then commits.
+
+   Threads that call log_sync() or log_commit() while a commit is
+   running, or while operations are in progress, wait together
+   and are all satisfied by a single later commit. */
+
+/* Identifies a log header. */
+#define LOG_MAGIC 0x4c4f4721
+
+/* Maximum number of sectors in one transaction. */
+#define LOG_CAPACITY (LOG_SECTOR_CNT - 1)
+
+/* Most sectors that one outermost operation writes to the log:
+   an inode, a directory's inode, and two sectors of directory
+   entries, with some to spare. */
+#define MAX_OP_SECTORS 8
+
+/* Log sectors kept for the free map: its inode, which holds the
+   whole free map on a small enough device. */
+#define FREE_MAP_SECTORS 1
+
+/* Timer ticks between background commits. */
+#define FLUSH_INTERVAL (TIMER_FREQ * 5)
+
+/* On-disk log header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct log_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t cnt;                       /* Sectors in committed log. */
+    block_sector_t sectors[LOG_CAPACITY]; /* Home of each logged sector. */
+    uint32_t unused[126 - LOG_CAPACITY]; /* Not used. */
+  };
+
+/* Running transaction. */
+static block_sector_t sectors[LOG_CAPACITY]; /* Sectors written. */
+static size_t sector_cnt;       /* Number of sectors written. */
+static int outstanding;         /* Operations in progress. */
+static struct thread *committer; /* Thread committing, if any. */
+static unsigned commits_started; /* Number of commits begun. */
+static unsigned commits_done;   /* Number of commits finished. */
+static struct lock log_lock;    /* Protects the above. */
+static struct condition log_cond; /* Signaled when commit finishes
+                                     or an operation ends. */
+
+static void commit_locked (void);
+static void wait_for_commit (unsigned);
+static void commit (void);
+static void write_header (size_t cnt);
+static void flush_daemon (void *aux);
+static bool log_full (void);
+
+/* Initializes the log.  If FORMAT is true, creates an empty log;
+   otherwise, replays the log if it holds a committed
+   transaction. */
+void
+log_init (bool format) 
+{
+  static struct log_header header;
+
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&log_lock);
+  cond_init (&log_cond);
+  sector_cnt = 0;
+  outstanding = 0;
+  committer = NULL;
+  commits_started = commits_done = 0;
+
+  if (format)
+    write_header (0);
+  else
+    {
+      block_read (fs_device, LOG_SECTOR, &header);
+      if (header.magic != LOG_MAGIC || header.cnt > LOG_CAPACITY)
+        PANIC ("file system has no valid metadata log");
+      if (header.cnt > 0)
+        {
+          static uint8_t data[BLOCK_SECTOR_SIZE];
+          size_t i;
+
+          for (i = 0; i < header.cnt; i++)
+            {
+              block_read (fs_device, LOG_SECTOR + 1 + i, data);
+              block_write (fs_device, header.sectors[i], data);
+            }
+          write_header (0);
+          printf ("filesys: replayed %u sectors from log\n",
+                  (unsigned) header.cnt);
+        }
+    }
+
+  thread_create ("log-flush", PRI_DEFAULT, flush_daemon, NULL);
+}
+
+/* Commits the running transaction and writes every modified
+   sector to disk. */
+void
+log_done (void) 
+{
+  log_sync ();
+}
+
+/* Begins an operation that modifies metadata, reserving room
+   for it in the log.  If there is no room, waits for the
+   operations in progress to end and then commits the running
+   transaction.  An operation nested inside one the thread has
+   already begun shares its reservation. */
+void
+log_begin (void) 
+{
+  struct thread *t = thread_current ();
+
+  if (t->log_depth++ > 0)
+    return;
+
+  lock_acquire (&log_lock);
+  if (committer != t)
+    {
+      while (committer != NULL || log_full ())
+        if (committer == NULL && outstanding == 0)
+          commit_locked ();
+        else
+          cond_wait (&log_cond, &log_lock);
+    }
+  outstanding++;
+  lock_release (&log_lock);
+}
+
+/* Ends an operation begun with log_begin(). */
+void
+log_end (void) 
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->log_depth > 0);
+  if (--t->log_depth > 0)
+    return;
+
+  lock_acquire (&log_lock);
+  ASSERT (outstanding > 0);
+  outstanding--;
+  cond_broadcast (&log_cond, &log_lock);
+  lock_release (&log_lock);
+}
+
+/* Returns true if the log lacks room to reserve for one more
+   operation beyond those in progress.  Must be called with
+   LOG_LOCK held. */
+static bool
+log_full (void) 
+{
+  return (sector_cnt + FREE_MAP_SECTORS
+          + (size_t) (outstanding + 1) * MAX_OP_SECTORS > LOG_CAPACITY);
+}
+
+/* Copies SIZE bytes from BUFFER into metadata sector SECTOR,
+   starting at offset OFS, as part of the running
+   transaction. */
+void
+log_write_at (block_sector_t sector, const void *buffer,
+              size_t ofs, size_t size) 
+{
+  lock_acquire (&log_lock);
+  if (cache_write_pinned (sector, buffer, ofs, size))
+    {
+      if (sector_cnt >= LOG_CAPACITY)
+        PANIC ("metadata log overflow");
+      sectors[sector_cnt++] = sector;
+    }
+  lock_release (&log_lock);
+}
+
+/* Commits the running transaction and writes every modified
+   sector to disk, so that all changes made before the call are
+   durable.  Must not be called from within an operation. */
+void
+log_sync (void) 
+{
+  lock_acquire (&log_lock);
+  wait_for_commit (commits_started + 1);
+  lock_release (&log_lock);
+}
+
+/* Makes all metadata changes made before the call durable, by
+   waiting for the commit that is underway, if any, or else
+   committing the running transaction if it is not empty.  Does
+   not write back unlogged data except as part of a commit.  Must
+   not be called from within an operation. */
+void
+log_commit (void) 
+{
+  lock_acquire (&log_lock);
+  if (committer != NULL)
+    wait_for_commit (commits_started);
+  else if (sector_cnt > 0)
+    wait_for_commit (commits_started + 1);
+  lock_release (&log_lock);
+}
+
+/* Waits until commit number TARGET has finished, starting it
+   when no commit or operation is in progress.  Must be called
+   with LOG_LOCK held. */
+static void
+wait_for_commit (unsigned target) 
+{
+  ASSERT (lock_held_by_current_thread (&log_lock));
+
+  while ((int) (commits_done - target) < 0)
+    if (committer == NULL && outstanding == 0)
+      commit_locked ();
+    else
+      cond_wait (&log_cond, &log_lock);
+}
+
+/* Commits the running transaction.  Must be called with LOG_LOCK
+   held while no operation is in progress and no commit is
+   underway.  Releases LOG_LOCK while committing, during which
+   other threads' operations wait in log_begin(). */
+static void
+commit_locked (void) 
+{
+  ASSERT (lock_held_by_current_thread (&log_lock));
+  ASSERT (outstanding == 0 && committer == NULL);
+
+  committer = thread_current ();
+  commits_started++;
+  lock_release (&log_lock);
+  commit ();
+  lock_acquire (&log_lock);
+  committer = NULL;
+  commits_done++;
+  cond_broadcast (&log_cond, &log_lock);
+}
+
+/* Commits the running transaction.  The caller must be the
+   committer. */
+static void
+commit (void) 
+{
+  static uint8_t data[BLOCK_SECTOR_SIZE];
+  size_t i;
+
+  ASSERT (committer == thread_current ());
+
+  /* Write out the free map, with this transaction's allocations
+     but not its releases, and the other sectors that are not
+     part of the transaction. */
+  free_map_flush ();
+  cache_flush ();
+
+  if (sector_cnt > 0)
+    {
+      /* Write the log, then commit it by writing its header. */
+      for (i = 0; i < sector_cnt; i++)
+        {
+          cache_read_at (sectors[i], data, 0, BLOCK_SECTOR_SIZE);
+          block_write (fs_device, LOG_SECTOR + 1 + i, data);
+        }
+      write_header (sector_cnt);
+
+      /* Write the logged sectors home, then empty the log. */
+      for (i = 0; i < sector_cnt; i++)
+        cache_unpin (sectors[i]);
+      cache_flush ();
+      write_header (0);
+      sector_cnt = 0;
+    }
+
+  /* Now that nothing committed refers to them, the sectors the
+     transaction released can be reused. */
+  free_map_commit ();
+}
+
+/* Writes a log header that records the first CNT sectors of the
+   running transaction. */
+static void
+write_header (size_t cnt) 
+{
+  static struct log_header header;
+
+  memset (&header, 0, sizeof header);
+  header.magic = LOG_MAGIC;
+  header.cnt = cnt;
+  memcpy (header.sectors, sectors, cnt * sizeof *sectors);
+  block_write (fs_device, LOG_SECTOR, &header);
+}
+
+/* Periodically commits the running transaction, so that little
+   is lost if the machine stops without shutting down the file
+   system.  Skips a round if an operation is in progress, but
+   still writes back unlogged sectors then. */
+static void
+flush_daemon (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      bool idle;
+
+      timer_sleep (FLUSH_INTERVAL);
+
+      lock_acquire (&log_lock);
+      idle = committer == NULL && outstanding == 0;
+      if (idle)
+        commit_locked ();
+      lock_release (&log_lock);
+
+      if (!idle)
+        cache_flush ();
+    }
+}
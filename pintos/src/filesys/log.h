@@ -0,0 +1,21 @@
+#ifndef FILESYS_LOG_H
+#define FILESYS_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Number of sectors reserved for the log, starting at
+   LOG_SECTOR: a header followed by the logged sectors. */
+#define LOG_SECTOR_CNT 33
+
+void log_init (bool format);
+void log_done (void);
+
+void log_begin (void);
+void log_end (void);
+void log_write_at (block_sector_t, const void *, size_t ofs, size_t size);
+void log_sync (void);
+void log_commit (void);
+
+#endif /* filesys/log.h */
@@ -0,0 +1,345 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Initial number of slots. */
+#define MIN_SLOTS 16
+
+/* Number of old-table slots moved to the new table by each
+   insertion or deletion during a resize.  Growth starts at 3/4
+   load, with the new table at 3/8 load, so any value of 2 or
+   more finishes the move before the new table needs to grow. */
+#define MOVE_STEP 8
+
+/* Value of an old-table slot whose entry has already been moved
+   to the new table or deleted.  Such a slot keeps its key, so
+   that probe distances past it stay correct for lookups. */
+static char moved_marker;
+#define MOVED ((void *) &moved_marker)
+
+static struct ohash_slot *find_slot (struct ohash_slot *, size_t slot_cnt,
+                                     uint32_t key);
+static void place (struct ohash_slot *, size_t slot_cnt,
+                   uint32_t key, void *value);
+static void remove_slot (struct ohash_slot *, size_t slot_cnt,
+                         struct ohash_slot *);
+static bool grow (struct ohash *);
+static void move_step (struct ohash *);
+
+/* Initializes hash table H.  Returns false if memory allocation
+   fails. */
+bool
+ohash_init (struct ohash *h)
+{
+  h->cnt = 0;
+  h->slot_cnt = MIN_SLOTS;
+  h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+  h->old_cnt = 0;
+  h->old_slot_cnt = 0;
+  h->old_slots = NULL;
+  h->old_pos = 0;
+  return h->slots != NULL;
+}
+
+/* Removes all the entries from H.
+
+   If ACTION is non-null, then it is called once for each entry
+   in the hash table, with AUX.  ACTION must not modify H. */
+void
+ohash_clear (struct ohash *h, ohash_action_func *action, void *aux)
+{
+  if (action != NULL)
+    ohash_apply (h, action, aux);
+
+  free (h->old_slots);
+  h->old_slots = NULL;
+  h->old_slot_cnt = h->old_cnt = h->old_pos = 0;
+
+  memset (h->slots, 0, h->slot_cnt * sizeof *h->slots);
+  h->cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If ACTION is non-null, then it is first called for each entry
+   in the hash table, with AUX.  ACTION must not modify H. */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *action, void *aux)
+{
+  ohash_clear (h, action, aux);
+  free (h->slots);
+}
+
+/* Inserts VALUE, which must be nonnull, into H under KEY, if no
+   value is stored under KEY yet, and returns a null pointer.
+   If a value is already stored under KEY, returns it without
+   modifying H.  If H is full and cannot grow because memory is
+   exhausted, returns VALUE itself without inserting it. */
+void *
+ohash_insert (struct ohash *h, uint32_t key, void *value)
+{
+  void *old;
+
+  ASSERT (value != NULL && value != MOVED);
+
+  old = ohash_find (h, key);
+  if (old != NULL)
+    return old;
+
+  /* Grow at 3/4 load.  If that fails we can keep going until the
+     table is nearly full, but must always leave one slot empty
+     so that probe sequences terminate. */
+  if ((h->cnt + h->old_cnt + 1) * 4 > h->slot_cnt * 3
+      && !grow (h)
+      && h->cnt + 1 >= h->slot_cnt)
+    return value;
+
+  move_step (h);
+  place (h->slots, h->slot_cnt, key, value);
+  h->cnt++;
+  return NULL;
+}
+
+/* Returns the value stored in H under KEY, or a null pointer if
+   there is none. */
+void *
+ohash_find (const struct ohash *h, uint32_t key)
+{
+  struct ohash_slot *s = find_slot (h->slots, h->slot_cnt, key);
+  if (s == NULL && h->old_slots != NULL)
+    s = find_slot (h->old_slots, h->old_slot_cnt, key);
+  return s != NULL ? s->value : NULL;
+}
+
+/* Removes the value stored in H under KEY and returns it.
+   Returns a null pointer if there is none. */
+void *
+ohash_delete (struct ohash *h, uint32_t key)
+{
+  struct ohash_slot *s;
+  void *value;
+
+  s = find_slot (h->slots, h->slot_cnt, key);
+  if (s != NULL)
+    {
+      value = s->value;
+      remove_slot (h->slots, h->slot_cnt, s);
+      h->cnt--;
+    }
+  else if (h->old_slots != NULL
+           && (s = find_slot (h->old_slots, h->old_slot_cnt, key)) != NULL)
+    {
+      /* Shifting entries back, as remove_slot() does, could move
+         an entry behind the resize's scan position, so just mark
+         the slot. */
+      value = s->value;
+      s->value = MOVED;
+      h->old_cnt--;
+    }
+  else
+    return NULL;
+
+  move_step (h);
+  return value;
+}
+
+/* Calls ACTION for each entry in hash table H in arbitrary
+   order, with AUX.  ACTION must not modify H. */
+void
+ohash_apply (struct ohash *h, ohash_action_func *action, void *aux)
+{
+  size_t i;
+
+  ASSERT (action != NULL);
+
+  for (i = 0; i < h->slot_cnt; i++)
+    if (h->slots[i].value != NULL)
+      action (h->slots[i].key, h->slots[i].value, aux);
+  if (h->old_slots != NULL)
+    for (i = h->old_pos; i < h->old_slot_cnt; i++)
+      if (h->old_slots[i].value != NULL && h->old_slots[i].value != MOVED)
+        action (h->old_slots[i].key, h->old_slots[i].value, aux);
+}
+
+/* Returns the number of entries in H. */
+size_t
+ohash_size (const struct ohash *h)
+{
+  return h->cnt + h->old_cnt;
+}
+
+/* Returns true if H contains no entries, false otherwise. */
+bool
+ohash_empty (const struct ohash *h)
+{
+  return ohash_size (h) == 0;
+}
+
+/* Returns the home slot for KEY in a table of SLOT_CNT slots.
+   The multiplication spreads keys that differ only in their low
+   bits, such as consecutive page numbers, and folding the high
+   half back down spreads keys that differ only in their high
+   bits. */
+static inline size_t
+home_slot (uint32_t key, size_t slot_cnt)
+{
+  uint32_t h = key * 2654435769u;
+  return (h ^ (h >> 16)) & (slot_cnt - 1);
+}
+
+/* Returns how far slot S, at index IDX in a table of SLOT_CNT
+   slots, is from its home slot. */
+static inline size_t
+distance (const struct ohash_slot *s, size_t idx, size_t slot_cnt)
+{
+  return (idx - home_slot (s->key, slot_cnt)) & (slot_cnt - 1);
+}
+
+/* Returns the slot among the SLOT_CNT at SLOTS that holds KEY, or
+   a null pointer if there is none. */
+static struct ohash_slot *
+find_slot (struct ohash_slot *slots, size_t slot_cnt, uint32_t key)
+{
+  size_t mask = slot_cnt - 1;
+  size_t i = home_slot (key, slot_cnt);
+  size_t dist;
+
+  for (dist = 0; dist < slot_cnt; dist++, i = (i + 1) & mask)
+    {
+      struct ohash_slot *s = &slots[i];
+
+      /* Robin Hood ordering means KEY would have displaced any
+         entry closer to its home than KEY is to its own. */
+      if (s->value == NULL || distance (s, i, slot_cnt) < dist)
+        return NULL;
+      if (s->key == key && s->value != MOVED)
+        return s;
+    }
+  return NULL;
+}
+
+/* Inserts KEY and VALUE among the SLOT_CNT at SLOTS, which must
+   not contain KEY and must have at least one empty slot. */
+static void
+place (struct ohash_slot *slots, size_t slot_cnt, uint32_t key, void *value)
+{
+  size_t mask = slot_cnt - 1;
+  size_t i = home_slot (key, slot_cnt);
+  size_t dist = 0;
+
+  for (;;)
+    {
+      struct ohash_slot *s = &slots[i];
+      size_t d;
+
+      if (s->value == NULL)
+        {
+          s->key = key;
+          s->value = value;
+          return;
+        }
+
+      /* Take the slot from an entry that is closer to home, and
+         carry on inserting that entry instead. */
+      d = distance (s, i, slot_cnt);
+      if (d < dist)
+        {
+          struct ohash_slot t = *s;
+          s->key = key;
+          s->value = value;
+          key = t.key;
+          value = t.value;
+          dist = d;
+        }
+      i = (i + 1) & mask;
+      dist++;
+    }
+}
+
+/* Removes slot S from the SLOT_CNT at SLOTS, shifting each
+   following entry that is not in its home slot back by one. */
+static void
+remove_slot (struct ohash_slot *slots, size_t slot_cnt, struct ohash_slot *s)
+{
+  size_t mask = slot_cnt - 1;
+  size_t i = s - slots;
+
+  for (;;)
+    {
+      size_t j = (i + 1) & mask;
+      struct ohash_slot *next = &slots[j];
+
+      if (next->value == NULL || distance (next, j, slot_cnt) == 0)
+        break;
+      slots[i] = *next;
+      i = j;
+    }
+  slots[i].value = NULL;
+}
+
+/* Starts moving H's entries to a table twice the size.  Returns
+   false if memory allocation fails. */
+static bool
+grow (struct ohash *h)
+{
+  struct ohash_slot *slots;
+  size_t slot_cnt = h->slot_cnt * 2;
+
+  /* Finish any resize already in progress. */
+  while (h->old_slots != NULL)
+    move_step (h);
+
+  slots = calloc (slot_cnt, sizeof *slots);
+  if (slots == NULL)
+    return false;
+
+  h->old_slots = h->slots;
+  h->old_slot_cnt = h->slot_cnt;
+  h->old_cnt = h->cnt;
+  h->old_pos = 0;
+
+  h->slots = slots;
+  h->slot_cnt = slot_cnt;
+  h->cnt = 0;
+  return true;
+}
+
+/* If H is being resized, moves the entries in the next
+   MOVE_STEP old slots to the new table, and frees the old table
+   once it is empty. */
+static void
+move_step (struct ohash *h)
+{
+  size_t end;
+
+  if (h->old_slots == NULL)
+    return;
+
+  end = h->old_pos + MOVE_STEP;
+  if (end > h->old_slot_cnt)
+    end = h->old_slot_cnt;
+  for (; h->old_pos < end; h->old_pos++)
+    {
+      struct ohash_slot *s = &h->old_slots[h->old_pos];
+      if (s->value != NULL && s->value != MOVED)
+        {
+          place (h->slots, h->slot_cnt, s->key, s->value);
+          s->value = MOVED;
+          h->cnt++;
+          h->old_cnt--;
+        }
+    }
+
+  if (h->old_pos == h->old_slot_cnt)
+    {
+      ASSERT (h->old_cnt == 0);
+      free (h->old_slots);
+      h->old_slots = NULL;
+      h->old_slot_cnt = h->old_pos = 0;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   Maps 32-bit integer keys, such as virtual page numbers or
+   sector numbers, to nonnull pointers.  Unlike the chained table
+   in hash.h, keys and values are stored inline in a single array
+   of slots, so a lookup usually touches one or two adjacent
+   slots instead of chasing list pointers across memory.
+
+   Collisions are resolved by linear probing with Robin Hood
+   ordering: an entry being inserted displaces any entry that is
+   closer to its home slot than the new entry is to its own.
+   This keeps probe sequences short and lets an unsuccessful
+   lookup stop as soon as it reaches an entry closer to home than
+   the key being sought.  Deletion shifts the following entries
+   back into the hole, so the table does not accumulate
+   tombstones.
+
+   The table grows incrementally.  When it becomes 3/4 full, a
+   table twice the size is allocated and subsequent insertions
+   and deletions each move a few entries from the old table to
+   the new one, so no single insertion pays for a full rehash.
+   Lookups consult both tables until the move is complete.
+   Entries deleted from the old table during the move are only
+   marked, since the old table is freed once it is empty.
+
+   The table never shrinks.  Its slots are allocated with
+   calloc(), so it may only be used after malloc_init(). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A slot in the table. */
+struct ohash_slot
+  {
+    uint32_t key;               /* Key. */
+    void *value;                /* Value, or a null pointer if empty. */
+  };
+
+/* Performs some operation on the entry with KEY and VALUE, given
+   auxiliary data AUX. */
+typedef void ohash_action_func (uint32_t key, void *value, void *aux);
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    size_t cnt;                 /* Number of entries in `slots'. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+
+    /* Table being drained into `slots' during a resize. */
+    size_t old_cnt;             /* Entries not yet moved. */
+    size_t old_slot_cnt;        /* Number of slots. */
+    struct ohash_slot *old_slots; /* Slots, or a null pointer. */
+    size_t old_pos;             /* Next slot to move. */
+  };
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *);
+void ohash_clear (struct ohash *, ohash_action_func *, void *aux);
+void ohash_destroy (struct ohash *, ohash_action_func *, void *aux);
+
+/* Search, insertion, deletion. */
+void *ohash_insert (struct ohash *, uint32_t key, void *value);
+void *ohash_find (const struct ohash *, uint32_t key);
+void *ohash_delete (struct ohash *, uint32_t key);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, ohash_action_func *, void *aux);
+
+/* Information. */
+size_t ohash_size (const struct ohash *);
+bool ohash_empty (const struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
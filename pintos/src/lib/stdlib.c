@@ -3,6 +3,7 @@
 #include <random.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Converts a string representation of a signed decimal integer
    in S into an `int', which is returned. */
@@ -48,56 +49,90 @@ compare_thunk (const void *a, const void *b, void *aux)
   return (*compare) (a, b);
 }
 
-/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
-   using COMPARE.  When COMPARE is passed a pair of elements A
-   and B, respectively, it must return a strcmp()-type result,
-   i.e. less than zero if A < B, zero if A == B, greater than
-   zero if A > B.  Runs in O(n lg n) time and O(1) space in
-   CNT. */
-void
-qsort (void *array, size_t cnt, size_t size,
-       int (*compare) (const void *, const void *)) 
+/* Sorting.
+
+   sort() and qsort() use introsort: quicksort with a
+   median-of-three pivot, switching to insertion sort for short
+   ranges, where it is faster than quicksort's overhead, and to
+   heapsort for any range that quicksort has split more than
+   about 2 lg n times, which bounds the worst case at O(n lg n).
+   Quicksort recurses only into the smaller half of each range
+   and loops on the larger, so the stack never grows beyond
+   O(lg n) frames.
+
+   Elements whose size is a multiple of the word size and that
+   start on a word boundary are swapped a word at a time. */
+
+/* Ranges with at most this many elements are insertion
+   sorted. */
+#define INSERTION_MAX 12
+
+/* State shared by the sorting helpers. */
+struct sort_state
+  {
+    size_t size;                /* Element size in bytes. */
+    bool word_swap;             /* Swap a word at a time? */
+
+    /* Exactly one of these comparison functions is nonnull.
+       qsort() supplies the first, sort() the second, so that
+       neither pays for calling the other's through a thunk. */
+    int (*compare) (const void *, const void *);
+    int (*compare_aux) (const void *, const void *, void *aux);
+    void *aux;
+  };
+
+/* Compares elements A and B according to S and returns a
+   strcmp()-type result. */
+static inline int
+do_compare (const struct sort_state *s, const void *a, const void *b) 
 {
-  sort (array, cnt, size, compare_thunk, &compare);
+  return (s->compare != NULL
+          ? s->compare (a, b)
+          : s->compare_aux (a, b, s->aux));
 }
 
-/* Swaps elements with 1-based indexes A_IDX and B_IDX in ARRAY
-   with elements of SIZE bytes each. */
-static void
-do_swap (unsigned char *array, size_t a_idx, size_t b_idx, size_t size)
+/* Swaps elements A and B, which are S->size bytes each. */
+static inline void
+do_swap (const struct sort_state *s, void *a_, void *b_)
 {
-  unsigned char *a = array + (a_idx - 1) * size;
-  unsigned char *b = array + (b_idx - 1) * size;
-  size_t i;
-
-  for (i = 0; i < size; i++)
+  if (s->word_swap) 
     {
-      unsigned char t = a[i];
-      a[i] = b[i];
-      b[i] = t;
+      uint32_t *a = a_;
+      uint32_t *b = b_;
+      size_t i;
+
+      for (i = 0; i < s->size / sizeof (uint32_t); i++)
+        {
+          uint32_t t = a[i];
+          a[i] = b[i];
+          b[i] = t;
+        }
     }
-}
+  else 
+    {
+      unsigned char *a = a_;
+      unsigned char *b = b_;
+      size_t i;
 
-/* Compares elements with 1-based indexes A_IDX and B_IDX in
-   ARRAY with elements of SIZE bytes each, using COMPARE to
-   compare elements, passing AUX as auxiliary data, and returns a
-   strcmp()-type result. */
-static int
-do_compare (unsigned char *array, size_t a_idx, size_t b_idx, size_t size,
-            int (*compare) (const void *, const void *, void *aux),
-            void *aux) 
-{
-  return compare (array + (a_idx - 1) * size, array + (b_idx - 1) * size, aux);
+      for (i = 0; i < s->size; i++)
+        {
+          unsigned char t = a[i];
+          a[i] = b[i];
+          b[i] = t;
+        }
+    }
 }
 
-/* "Float down" the element with 1-based index I in ARRAY of CNT
-   elements of SIZE bytes each, using COMPARE to compare
-   elements, passing AUX as auxiliary data. */
+/* "Float down" the element with 1-based index I in the heap of
+   CNT elements that starts at ARRAY. */
 static void
-heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
-         int (*compare) (const void *, const void *, void *aux),
-         void *aux) 
+heapify (const struct sort_state *s, unsigned char *array, size_t i,
+         size_t cnt) 
 {
+  /* Subtracting one element lets 1-based indexes address
+     ARRAY directly. */
+  unsigned char *base = array - s->size;
+
   for (;;) 
     {
       /* Set `max' to the index of the largest element among I
@@ -105,10 +140,11 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
       size_t left = 2 * i;
       size_t right = 2 * i + 1;
       size_t max = i;
-      if (left <= cnt && do_compare (array, left, max, size, compare, aux) > 0)
+      if (left <= cnt
+          && do_compare (s, base + left * s->size, base + max * s->size) > 0)
         max = left;
       if (right <= cnt
-          && do_compare (array, right, max, size, compare, aux) > 0) 
+          && do_compare (s, base + right * s->size, base + max * s->size) > 0)
         max = right;
 
       /* If the maximum value is already in element I, we're
@@ -117,38 +153,164 @@ heapify (unsigned char *array, size_t i, size_t cnt, size_t size,
         break;
 
       /* Swap and continue down the heap. */
-      do_swap (array, i, max, size);
+      do_swap (s, base + i * s->size, base + max * s->size);
       i = max;
     }
 }
 
+/* Sorts the CNT elements at ARRAY with heapsort. */
+static void
+heap_sort (const struct sort_state *s, unsigned char *array, size_t cnt) 
+{
+  size_t i;
+
+  /* Build a heap. */
+  for (i = cnt / 2; i > 0; i--)
+    heapify (s, array, i, cnt);
+
+  /* Sort the heap. */
+  for (i = cnt; i > 1; i--) 
+    {
+      do_swap (s, array, array + (i - 1) * s->size);
+      heapify (s, array, 1, i - 1); 
+    }
+}
+
+/* Sorts the CNT elements at ARRAY with insertion sort. */
+static void
+insertion_sort (const struct sort_state *s, unsigned char *array, size_t cnt) 
+{
+  unsigned char *end = array + cnt * s->size;
+  unsigned char *p, *q;
+
+  for (p = array + s->size; p < end; p += s->size)
+    for (q = p; q > array && do_compare (s, q - s->size, q) > 0; q -= s->size)
+      do_swap (s, q - s->size, q);
+}
+
+/* Sorts the CNT elements at ARRAY, falling back to heapsort
+   once DEPTH more levels of partitioning have been used up. */
+static void
+intro_sort (const struct sort_state *s, unsigned char *array, size_t cnt,
+            unsigned depth) 
+{
+  while (cnt > INSERTION_MAX) 
+    {
+      unsigned char *first = array;
+      unsigned char *middle = array + (cnt / 2) * s->size;
+      unsigned char *last = array + (cnt - 1) * s->size;
+      size_t i, j;
+
+      if (depth-- == 0) 
+        {
+          heap_sort (s, array, cnt);
+          return;
+        }
+
+      /* Order the first, middle, and last elements, then move
+         their median, the pivot, to the front. */
+      if (do_compare (s, middle, first) < 0)
+        do_swap (s, middle, first);
+      if (do_compare (s, last, middle) < 0) 
+        {
+          do_swap (s, last, middle);
+          if (do_compare (s, middle, first) < 0)
+            do_swap (s, middle, first);
+        }
+      do_swap (s, first, middle);
+
+      /* Partition the rest around the pivot.  Both scans stop
+         at elements equal to the pivot, which keeps the halves
+         balanced when there are many duplicates. */
+      i = 0;
+      j = cnt;
+      for (;;) 
+        {
+          while (++i < cnt - 1
+                 && do_compare (s, array + i * s->size, first) < 0)
+            continue;
+          while (--j > 0 && do_compare (s, first, array + j * s->size) < 0)
+            continue;
+          if (i >= j)
+            break;
+          do_swap (s, array + i * s->size, array + j * s->size);
+        }
+      do_swap (s, first, array + j * s->size);
+
+      /* Now elements [0, j) are no greater than the pivot at
+         element j, and elements (j, cnt) are no less.  Recurse
+         on the smaller side and loop on the larger. */
+      if (j < cnt - j - 1) 
+        {
+          intro_sort (s, array, j, depth);
+          array += (j + 1) * s->size;
+          cnt -= j + 1;
+        }
+      else 
+        {
+          intro_sort (s, array + (j + 1) * s->size, cnt - j - 1, depth);
+          cnt = j;
+        }
+    }
+  insertion_sort (s, array, cnt);
+}
+
+/* Sorts the CNT elements of SIZE bytes at ARRAY using exactly
+   one of COMPARE and COMPARE_AUX (passing it AUX). */
+static void
+do_sort (void *array, size_t cnt, size_t size,
+         int (*compare) (const void *, const void *),
+         int (*compare_aux) (const void *, const void *, void *aux),
+         void *aux) 
+{
+  struct sort_state s;
+  unsigned depth;
+  size_t n;
+
+  ASSERT (array != NULL || cnt == 0);
+  ASSERT (size > 0);
+
+  s.size = size;
+  s.word_swap = (size % sizeof (uint32_t) == 0
+                 && (uintptr_t) array % sizeof (uint32_t) == 0);
+  s.compare = compare;
+  s.compare_aux = compare_aux;
+  s.aux = aux;
+
+  /* Allow 2 * floor(lg CNT) levels of partitioning. */
+  for (depth = 0, n = cnt; n > 1; n /= 2)
+    depth += 2;
+
+  intro_sort (&s, array, cnt, depth);
+}
+
+/* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
+   using COMPARE.  When COMPARE is passed a pair of elements A
+   and B, respectively, it must return a strcmp()-type result,
+   i.e. less than zero if A < B, zero if A == B, greater than
+   zero if A > B.  Runs in O(n lg n) time and O(lg n) space in
+   CNT. */
+void
+qsort (void *array, size_t cnt, size_t size,
+       int (*compare) (const void *, const void *)) 
+{
+  ASSERT (compare != NULL);
+  do_sort (array, cnt, size, compare, NULL, NULL);
+}
+
 /* Sorts ARRAY, which contains CNT elements of SIZE bytes each,
    using COMPARE to compare elements, passing AUX as auxiliary
    data.  When COMPARE is passed a pair of elements A and B,
    respectively, it must return a strcmp()-type result, i.e. less
    than zero if A < B, zero if A == B, greater than zero if A >
-   B.  Runs in O(n lg n) time and O(1) space in CNT. */
+   B.  Runs in O(n lg n) time and O(lg n) space in CNT. */
 void
 sort (void *array, size_t cnt, size_t size,
       int (*compare) (const void *, const void *, void *aux),
       void *aux) 
 {
-  size_t i;
-
-  ASSERT (array != NULL || cnt == 0);
   ASSERT (compare != NULL);
-  ASSERT (size > 0);
-
-  /* Build a heap. */
-  for (i = cnt / 2; i > 0; i--)
-    heapify (array, i, cnt, size, compare, aux);
-
-  /* Sort the heap. */
-  for (i = cnt; i > 1; i--) 
-    {
-      do_swap (array, 1, i, size);
-      heapify (array, 1, i - 1, size, compare, aux); 
-    }
+  do_sort (array, cnt, size, NULL, compare, aux);
 }
 
 /* Searches ARRAY, which contains CNT elements of SIZE bytes
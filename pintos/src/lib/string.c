@@ -1,5 +1,79 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below (memcpy, memmove, memcmp, memset)
+   move 32-bit words at a time once a block is big enough to
+   make it worthwhile.  They first handle bytes one at a time
+   until the destination is word-aligned, then move whole words
+   with the x86 string instructions, then finish off the last few
+   bytes one at a time.  Blocks shorter than WORD_MIN bytes are
+   always handled a byte at a time, since the string instructions
+   have a startup cost that dwarfs the copy itself. */
+#define WORD_MIN 16
+
+/* A 32-bit word that may alias any other type. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Copies SIZE bytes from SRC to DST, front to back, a word at a
+   time where possible.  DST must not lie within the SIZE bytes
+   after SRC, although it may precede it. */
+static void
+copy_forward (unsigned char *dst, const unsigned char *src, size_t size) 
+{
+  if (size >= WORD_MIN) 
+    {
+      size_t head = -(uintptr_t) dst % sizeof (word_t);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+    }
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Copies SIZE bytes from SRC to DST, back to front, a word at a
+   time where possible.  DST may lie within the SIZE bytes after
+   SRC. */
+static void
+copy_backward (unsigned char *dst, const unsigned char *src, size_t size) 
+{
+  dst += size;
+  src += size;
+  if (size >= WORD_MIN) 
+    {
+      size_t tail = (uintptr_t) dst % sizeof (word_t);
+      size_t words;
+
+      size -= tail;
+      while (tail-- > 0)
+        *--dst = *--src;
+
+      /* With the direction flag set, `rep movsl' starts at the
+         word that ESI and EDI point to and works downward,
+         leaving them pointing one word below the last word
+         copied. */
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      dst -= sizeof (word_t);
+      src -= sizeof (word_t);
+      asm volatile ("std; rep movsl; cld"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+      dst += sizeof (word_t);
+      src += sizeof (word_t);
+    }
+  while (size-- > 0)
+    *--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +86,7 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  copy_forward (dst, src, size);
 
   return dst_;
 }
@@ -29,20 +102,12 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
-    }
+  if (dst <= src || dst >= src + size) 
+    copy_forward (dst, src, size);
+  else
+    copy_backward (dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +123,24 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* If A and B can be word-aligned together, skip over equal
+     words.  The first unequal word, if any, is left for the
+     byte loop to pin down. */
+  if (size >= WORD_MIN
+      && (uintptr_t) a % sizeof (word_t) == (uintptr_t) b % sizeof (word_t)) 
+    {
+      for (; (uintptr_t) a % sizeof (word_t) != 0; a++, b++, size--)
+        if (*a != *b)
+          return *a > *b ? +1 : -1;
+      while (size >= sizeof (word_t)
+             && *(const word_t *) a == *(const word_t *) b) 
+        {
+          a += sizeof (word_t);
+          b += sizeof (word_t);
+          size -= sizeof (word_t);
+        }
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,7 +364,24 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= WORD_MIN) 
+    {
+      size_t head = -(uintptr_t) dst % sizeof (word_t);
+      word_t word = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (word)
+                    : "memory");
+    }
   while (size-- > 0)
     *dst++ = value;
 
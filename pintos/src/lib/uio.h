@@ -0,0 +1,19 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+/* Scatter/gather I/O vectors, as used by the readv() and
+   writev() system calls. */
+
+#include <stddef.h>
+
+/* One buffer in a vector. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Maximum number of buffers in one readv() or writev() call. */
+#define IOV_MAX 64
+
+#endif /* lib/uio.h */
@@ -0,0 +1,42 @@
+/* Child process for jnl-replay test.
+   Creates, fills, and removes files in an endless loop, so that
+   the machine is stopped by the test's timeout in the middle of
+   some file system operation. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/jnl.h"
+
+static char buf[JNL_MAX_SIZE];
+
+int
+main (void)
+{
+  test_name = "child-jnl";
+  quiet = true;
+
+  random_init (0);
+  for (;;)
+    {
+      int idx = random_ulong () % JNL_FILE_CNT;
+      size_t size = jnl_size (idx);
+      char name[16];
+      int fd;
+
+      jnl_name (idx, name);
+      if (random_ulong () % 3 == 0)
+        {
+          remove (name);
+          continue;
+        }
+      if (!create (name, size) || (fd = open (name)) < 2)
+        continue;
+
+      /* Fill a random prefix, leaving the rest zero. */
+      memset (buf, jnl_byte (idx), size);
+      write (fd, buf, random_ulong () % (size + 1));
+      close (fd);
+    }
+}
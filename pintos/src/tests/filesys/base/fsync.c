@@ -0,0 +1,30 @@
+/* Writes a file, flushes it with fsync() and then everything
+   with sync(), and verifies that the file is unchanged.  Also
+   checks that fsync() rejects a file descriptor that is not
+   open. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5678];
+
+void
+test_main (void) 
+{
+  const char *file_name = "durable";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  CHECK (fsync (fd + 1) == -1, "fsync unopened fd");
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  msg ("sync");
+  sync ();
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync) begin
+(fsync) create "durable"
+(fsync) open "durable"
+(fsync) write "durable"
+(fsync) fsync "durable"
+(fsync) fsync unopened fd
+(fsync) close "durable"
+(fsync) sync
+(fsync) open "durable" for verification
+(fsync) verified contents of "durable"
+(fsync) close "durable"
+(fsync) end
+EOF
+pass;
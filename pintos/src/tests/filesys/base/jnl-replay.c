@@ -0,0 +1,54 @@
+/* Checks the file system left behind when child-jnl was stopped
+   partway through an operation.  Every file that exists must
+   have the size it was created with and contain only its own
+   fill byte and zeros, which fails if the metadata log was not
+   replayed or if freed sectors were reused before the free was
+   committed.  Then verifies that the file system is still
+   usable by creating and reading back a new file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/base/jnl.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[JNL_MAX_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "after-replay";
+  int idx;
+  int fd;
+
+  for (idx = 0; idx < JNL_FILE_CNT; idx++)
+    {
+      size_t size = jnl_size (idx);
+      char name[16];
+      size_t i;
+
+      jnl_name (idx, name);
+      fd = open (name);
+      if (fd < 0)
+        continue;
+
+      if ((size_t) filesize (fd) != size)
+        fail ("\"%s\" has size %d, expected %zu", name, filesize (fd), size);
+      if ((size_t) read (fd, buf, size) != size)
+        fail ("read \"%s\" failed", name);
+      for (i = 0; i < size; i++)
+        if (buf[i] != jnl_byte (idx) && buf[i] != 0)
+          fail ("byte %zu of \"%s\" is %02hhx", i, name, buf[i]);
+      close (fd);
+    }
+  msg ("files check out");
+
+  memset (buf, 'x', jnl_size (1));
+  CHECK (create (file_name, jnl_size (1)), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, jnl_size (1)) == (int) jnl_size (1),
+         "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, jnl_size (1));
+}
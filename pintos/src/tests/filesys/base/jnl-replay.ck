@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(jnl-replay) begin
+(jnl-replay) files check out
+(jnl-replay) create "after-replay"
+(jnl-replay) open "after-replay"
+(jnl-replay) write "after-replay"
+(jnl-replay) close "after-replay"
+(jnl-replay) open "after-replay" for verification
+(jnl-replay) verified contents of "after-replay"
+(jnl-replay) close "after-replay"
+(jnl-replay) end
+EOF
+pass;
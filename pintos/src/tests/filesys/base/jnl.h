@@ -0,0 +1,34 @@
+#ifndef TESTS_FILESYS_BASE_JNL_H
+#define TESTS_FILESYS_BASE_JNL_H
+
+#include <stdio.h>
+
+/* Files used by child-jnl and jnl-replay. */
+#define JNL_FILE_CNT 8
+
+/* Buffer size large enough for the largest file. */
+#define JNL_MAX_SIZE 8192
+
+/* Returns the size of file IDX. */
+static inline size_t
+jnl_size (int idx)
+{
+  return 37 + idx * 1021;
+}
+
+/* Returns the byte that file IDX is filled with.  Bytes not yet
+   written read as zeros. */
+static inline char
+jnl_byte (int idx)
+{
+  return 'a' + idx;
+}
+
+/* Stores the name of file IDX into NAME. */
+static inline void
+jnl_name (int idx, char name[16])
+{
+  snprintf (name, 16, "jnl%d", idx);
+}
+
+#endif /* tests/filesys/base/jnl.h */
@@ -0,0 +1,32 @@
+/* Copies part of a file into another with copy_file_range() and
+   checks the result and both file positions. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int in, out, byte_cnt;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  seek (in, 10);
+  seek (out, 10);
+  byte_cnt = copy_file_range (in, out, 100000);
+  if (byte_cnt != (int) size - 10)
+    fail ("copy_file_range() returned %d instead of %zu", byte_cnt, size - 10);
+  if (tell (in) != size || tell (out) != size)
+    fail ("positions are %u and %u, not %zu", tell (in), tell (out), size);
+
+  seek (in, 0);
+  seek (out, 0);
+  CHECK (copy_file_range (in, out, 10) == 10, "copy first 10 bytes");
+  CHECK (copy_file_range (in, out + 1, 10) == -1, "copy to bad fd");
+  check_file_handle (out, "test.txt", sample, size);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "test.txt"
+(copy-range) open "test.txt"
+(copy-range) copy first 10 bytes
+(copy-range) copy to bad fd
+(copy-range) verified contents of "test.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
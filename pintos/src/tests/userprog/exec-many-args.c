@@ -0,0 +1,100 @@
+/* Runs itself with enough arguments that they take up more than
+   a page of stack, and checks that each one arrives intact.  Then
+   does the same with arguments that fill all but a few bytes of a
+   page, and checks that the child still has stack to run in.
+   Finally checks that a command line too big for the argument
+   limit is refused instead of overflowing the stack. */
+
+#include <round.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Number of arguments passed after the program name. */
+#define ARG_CNT 600
+
+/* Page size, and bytes of stack a child uses beyond its
+   arguments. */
+#define PAGE_SIZE 4096
+#define CHILD_STACK 1024
+
+const char *test_name = "exec-many-args";
+
+/* Command lines are kept out of the stack, which is only a page
+   or so. */
+static char cmdline[ARG_CNT * 8 + 32];
+static char huge[65536];
+
+/* Sets CMDLINE to this program's name followed by arguments "a1"
+   through "aCNT", and returns how many bytes of stack the kernel
+   lays them out in: the strings, padded to a word, then argv[]
+   with its null pointer, argv, argc, and a return address. */
+static size_t
+make_cmdline (int cnt) 
+{
+  size_t ofs;
+  size_t size;
+  int i;
+
+  ofs = strlcpy (cmdline, test_name, sizeof cmdline);
+  size = ofs + 1;
+  for (i = 1; i <= cnt; i++)
+    {
+      int len = snprintf (cmdline + ofs, sizeof cmdline - ofs, " a%d", i);
+      ofs += len;
+      size += len;
+    }
+  return ROUND_UP (size, sizeof (char *)) + (cnt + 4) * sizeof (char *);
+}
+
+/* Writes to CHILD_STACK bytes of stack below the caller. */
+static void
+use_stack (void) 
+{
+  volatile char buf[CHILD_STACK];
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int cnt;
+
+  /* A child checks its arguments, makes sure it has some stack
+     to use, and exits with how many arguments there were. */
+  if (argc > 1)
+    {
+      int i;
+
+      for (i = 1; i < argc; i++) 
+        {
+          char expected[16];
+          snprintf (expected, sizeof expected, "a%d", i);
+          if (strcmp (argv[i], expected))
+            return -1;
+        }
+      use_stack ();
+      return argv[argc] == NULL ? argc - 1 : -1;
+    }
+
+  msg ("begin");
+  make_cmdline (ARG_CNT);
+  msg ("exec with %d arguments: %d", ARG_CNT, wait (exec (cmdline)));
+
+  /* The most arguments that leave part of a page free. */
+  for (cnt = 1; make_cmdline (cnt + 1) < PAGE_SIZE; cnt++)
+    continue;
+  make_cmdline (cnt);
+  CHECK (wait (exec (cmdline)) == cnt,
+         "exec with arguments just under a page");
+
+  memset (huge, 'x', sizeof huge - 1);
+  msg ("exec with %zu-byte argument: %d", sizeof huge - 1, exec (huge));
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(exec-many-args) begin
+(exec-many-args) exec with 600 arguments: 600
+(exec-many-args) exec with arguments just under a page
+(exec-many-args) exec with 65535-byte argument: -1
+(exec-many-args) end
+EOF
+pass;
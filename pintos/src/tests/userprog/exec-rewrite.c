@@ -0,0 +1,21 @@
+/* Runs child-simple, overwrites its ELF header, and checks that
+   running it again fails instead of reusing the header read the
+   first time. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char garbage[64] = "not an executable";
+  int handle;
+
+  msg ("wait(exec()) = %d", wait (exec ("child-simple")));
+  CHECK ((handle = open ("child-simple")) > 1, "open \"child-simple\"");
+  CHECK (write (handle, garbage, sizeof garbage) == sizeof garbage,
+         "overwrite ELF header");
+  close (handle);
+  msg ("exec(\"child-simple\"): %d", exec ("child-simple"));
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-rewrite) begin
+(child-simple) run
+child-simple: exit(81)
+(exec-rewrite) wait(exec()) = 81
+(exec-rewrite) open "child-simple"
+(exec-rewrite) overwrite ELF header
+load: child-simple: error loading executable
+(exec-rewrite) exec("child-simple"): -1
+(exec-rewrite) end
+exec-rewrite: exit(0)
+EOF
+pass;
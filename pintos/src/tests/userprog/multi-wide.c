@@ -0,0 +1,45 @@
+/* Executes itself as CHILD_CNT children, all started before any
+   is waited for, and checks each child's exit code.  There are
+   more children than the kernel once allowed threads. */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define CHILD_CNT 40
+
+const char *test_name = "multi-wide";
+
+int
+main (int argc, char *argv[]) 
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  /* A child just exits with the code it was given. */
+  if (argc > 1)
+    return atoi (argv[1]);
+
+  msg ("begin");
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      char child_cmd[128];
+      snprintf (child_cmd, sizeof child_cmd, "multi-wide %d", i);
+      children[i] = exec (child_cmd);
+      if (children[i] == PID_ERROR)
+        fail ("exec(\"%s\") failed", child_cmd);
+    }
+  msg ("exec %d children", CHILD_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      int code = wait (children[i]);
+      if (code != i)
+        fail ("wait for child %d returned %d", i, code);
+    }
+  msg ("wait for %d children", CHILD_CNT);
+  msg ("end");
+  return 0;
+}
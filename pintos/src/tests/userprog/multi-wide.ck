@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(multi-wide) begin
+(multi-wide) exec 40 children
+(multi-wide) wait for 40 children
+(multi-wide) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Points standard output at a pipe while executing child-simple,
+   then reads what the child printed back from the pipe. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char expected[] = "(child-simple) run\n";
+  char buffer[64];
+  int fds[2], byte_cnt = 0, n;
+  pid_t pid;
+
+  CHECK (pipe (fds) == 0, "pipe");
+
+  /* Nothing can be printed while standard output is redirected. */
+  dup2 (fds[1], STDOUT_FILENO);
+  pid = exec ("child-simple");
+  close (STDOUT_FILENO);
+  close (fds[1]);
+  CHECK (wait (pid) == 81, "wait for child");
+
+  while ((n = read (fds[0], buffer + byte_cnt,
+                    sizeof buffer - 1 - byte_cnt)) > 0)
+    byte_cnt += n;
+  buffer[byte_cnt] = '\0';
+  if (strcmp (buffer, expected))
+    fail ("read \"%s\" from pipe", buffer);
+  msg ("read child's output from pipe");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-child) begin
+(pipe-child) pipe
+child-simple: exit(81)
+(pipe-child) wait for child
+(pipe-child) read child's output from pipe
+(pipe-child) end
+pipe-child: exit(0)
+EOF
+pass;
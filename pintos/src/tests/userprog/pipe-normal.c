@@ -0,0 +1,32 @@
+/* Writes to a pipe and reads the data back, then checks end of
+   file after the write end is closed and that writing fails once
+   the read end is closed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char data[] = "through the pipe";
+  char buffer[sizeof data];
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], data, sizeof data) == sizeof data, "write pipe");
+  CHECK (read (fds[0], buffer, sizeof buffer) == sizeof data, "read pipe");
+  if (memcmp (buffer, data, sizeof data))
+    fail ("read \"%s\" instead of \"%s\"", buffer, data);
+  CHECK (read (fds[1], buffer, sizeof buffer) == -1,
+         "read from write end");
+
+  close (fds[1]);
+  CHECK (read (fds[0], buffer, sizeof buffer) == 0, "read end of file");
+
+  CHECK (pipe (fds) == 0, "pipe");
+  close (fds[0]);
+  CHECK (write (fds[1], data, sizeof data) == -1, "write without reader");
+  close (fds[1]);
+}
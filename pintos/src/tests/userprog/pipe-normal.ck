@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-normal) begin
+(pipe-normal) pipe
+(pipe-normal) write pipe
+(pipe-normal) read pipe
+(pipe-normal) read from write end
+(pipe-normal) read end of file
+(pipe-normal) pipe
+(pipe-normal) write without reader
+(pipe-normal) end
+pipe-normal: exit(0)
+EOF
+pass;
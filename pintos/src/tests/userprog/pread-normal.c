@@ -0,0 +1,25 @@
+/* Reads pieces of a file out of order with pread() and checks
+   that the file position is not affected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample - 1];
+  size_t half = (sizeof sample - 1) / 2;
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (pread (handle, buf + half, sizeof buf - half, half)
+         == (int) (sizeof buf - half), "pread second half");
+  CHECK (pread (handle, buf, half, 0) == (int) half, "pread first half");
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+  if (tell (handle) != 0)
+    fail ("tell() returned %u after pread()", tell (handle));
+  CHECK (pread (handle, buf, sizeof buf, sizeof buf) == 0, "pread at end");
+}
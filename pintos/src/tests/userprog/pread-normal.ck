@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-normal) begin
+(pread-normal) open "sample.txt"
+(pread-normal) pread second half
+(pread-normal) pread first half
+(pread-normal) pread at end
+(pread-normal) end
+pread-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Writes a file back to front with pwrite() and checks that the
+   file position is not affected. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t ofs;
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  msg ("pwrite 100-byte chunks from the end");
+  ofs = size;
+  while (ofs > 0)
+    {
+      size_t chunk = ofs % 100 != 0 ? ofs % 100 : 100;
+      ofs -= chunk;
+      if (pwrite (handle, sample + ofs, chunk, ofs) != (int) chunk)
+        fail ("pwrite() of %zu bytes at %zu failed", chunk, ofs);
+    }
+  if (tell (handle) != 0)
+    fail ("tell() returned %u after pwrite()", tell (handle));
+
+  check_file_handle (handle, "test.txt", sample, size);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pwrite-normal) begin
+(pwrite-normal) create "test.txt"
+(pwrite-normal) open "test.txt"
+(pwrite-normal) pwrite 100-byte chunks from the end
+(pwrite-normal) verified contents of "test.txt"
+(pwrite-normal) end
+pwrite-normal: exit(0)
+EOF
+pass;
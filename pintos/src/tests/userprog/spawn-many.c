@@ -0,0 +1,58 @@
+/* Starts SPAWN_CNT copies of itself and one missing program with a
+   single spawn_many() call, then checks the pids it returned and
+   waits for each child.  Also checks that an oversized count is
+   rejected. */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define SPAWN_CNT 8
+
+const char *test_name = "spawn-many";
+
+int
+main (int argc, char *argv[]) 
+{
+  char cmds[SPAWN_CNT][32];
+  const char *cmd_ptrs[SPAWN_CNT + 1];
+  pid_t pids[SPAWN_CNT + 1];
+  int i;
+
+  /* A child just exits with the code it was given. */
+  if (argc > 1)
+    return atoi (argv[1]);
+
+  msg ("begin");
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      snprintf (cmds[i], sizeof cmds[i], "spawn-many %d", i);
+      cmd_ptrs[i] = cmds[i];
+    }
+  cmd_ptrs[SPAWN_CNT] = "no-such-file";
+
+  CHECK (spawn_many (cmd_ptrs, SPAWN_CNT + 1, pids) == SPAWN_CNT,
+         "spawn_many %d programs", SPAWN_CNT + 1);
+  CHECK (pids[SPAWN_CNT] == PID_ERROR, "missing program not started");
+
+  for (i = 0; i < SPAWN_CNT; i++) 
+    {
+      int code;
+      if (pids[i] == PID_ERROR)
+        fail ("child %d not started", i);
+      code = wait (pids[i]);
+      if (code != i)
+        fail ("wait for child %d returned %d", i, code);
+    }
+  msg ("wait for %d children", SPAWN_CNT);
+  CHECK (spawn_many (cmd_ptrs, 0, pids) == 0, "spawn_many nothing");
+
+  /* Too many to start, and so many that their sizes overflow.
+     Rejected before the arrays are looked at. */
+  CHECK (spawn_many (cmd_ptrs, 0x40000001, pids) == -1,
+         "spawn_many too many");
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(spawn-many) begin
+(spawn-many) spawn_many 9 programs
+(spawn-many) missing program not started
+(spawn-many) wait for 8 children
+(spawn-many) spawn_many nothing
+(spawn-many) spawn_many too many
+(spawn-many) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Executes itself as CHILD_CNT children and reaps them all with
+   wait_any(), checking that each child is returned exactly once
+   with its own exit code, and that nothing is left afterward. */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define CHILD_CNT 10
+
+const char *test_name = "wait-any";
+
+int
+main (int argc, char *argv[]) 
+{
+  pid_t children[CHILD_CNT];
+  bool reaped[CHILD_CNT];
+  int i, status;
+
+  /* A child just exits with the code it was given. */
+  if (argc > 1)
+    return atoi (argv[1]);
+
+  msg ("begin");
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      char child_cmd[128];
+      snprintf (child_cmd, sizeof child_cmd, "wait-any %d", i);
+      children[i] = exec (child_cmd);
+      if (children[i] == PID_ERROR)
+        fail ("exec(\"%s\") failed", child_cmd);
+      reaped[i] = false;
+    }
+  msg ("exec %d children", CHILD_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++) 
+    {
+      pid_t pid = wait_any (&status);
+      int j;
+
+      for (j = 0; j < CHILD_CNT; j++)
+        if (children[j] == pid)
+          break;
+      if (j == CHILD_CNT)
+        fail ("wait_any() returned %d, not a child", pid);
+      if (reaped[j])
+        fail ("wait_any() returned child %d twice", j);
+      if (status != j)
+        fail ("child %d exited with %d", j, status);
+      reaped[j] = true;
+    }
+  msg ("wait_any for %d children", CHILD_CNT);
+
+  CHECK (wait_any (&status) == -1, "wait_any with no children");
+  CHECK (wait (children[0]) == -1, "wait for reaped child");
+  msg ("end");
+  return 0;
+}
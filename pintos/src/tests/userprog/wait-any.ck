@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(wait-any) begin
+(wait-any) exec 10 children
+(wait-any) wait_any for 10 children
+(wait-any) wait_any with no children
+(wait-any) wait for reaped child
+(wait-any) end
+EOF
+pass;
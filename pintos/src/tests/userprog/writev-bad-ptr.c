@@ -0,0 +1,25 @@
+/* Passes writev() a vector whose second buffer is at an
+   invalid address.  The process must be terminated with -1
+   exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[2];
+  char buf[16] = "";
+  int handle;
+
+  CHECK (create ("test.txt", sizeof buf), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = buf;
+  iov[0].iov_len = sizeof buf;
+  iov[1].iov_base = (char *) 0xc0100000;
+  iov[1].iov_len = 123;
+  writev (handle, iov, 2);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-bad-ptr) begin
+(writev-bad-ptr) create "test.txt"
+(writev-bad-ptr) open "test.txt"
+writev-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Writes a file from three buffers with one writev() call. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 5;
+  iov[1].iov_base = sample + 5;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 5;
+  iov[2].iov_len = size - 5;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size);
+  msg ("close \"test.txt\"");
+  close (handle);
+  check_file ("test.txt", sample, size);
+}
@@ -39,12 +39,13 @@ static void
 sort_chunks (const char *subprocess, int exit_status)
 {
   pid_t children[CHUNK_CNT];
+  char cmds[CHUNK_CNT][128];
+  const char *cmd_ptrs[CHUNK_CNT];
   size_t i;
 
   for (i = 0; i < CHUNK_CNT; i++) 
     {
       char fn[128];
-      char cmd[128];
       int handle;
 
       msg ("sort chunk %zu", i);
@@ -56,13 +57,18 @@ sort_chunks (const char *subprocess, int exit_status)
       CHECK ((handle = open (fn)) > 1, "open \"%s\"", fn);
       write (handle, buf1 + CHUNK_SIZE * i, CHUNK_SIZE);
       close (handle);
-
-      /* Sort with subprocess. */
-      snprintf (cmd, sizeof cmd, "%s %s", subprocess, fn);
-      CHECK ((children[i] = exec (cmd)) != -1, "exec \"%s\"", cmd);
       quiet = false;
+
+      snprintf (cmds[i], sizeof cmds[i], "%s %s", subprocess, fn);
+      cmd_ptrs[i] = cmds[i];
     }
 
+  /* Sort with subprocesses, all loaded at once. */
+  quiet = true;
+  CHECK (spawn_many (cmd_ptrs, CHUNK_CNT, children) == CHUNK_CNT,
+         "spawn_many %d \"%s\"", CHUNK_CNT, subprocess);
+  quiet = false;
+
   for (i = 0; i < CHUNK_CNT; i++) 
     {
       char fn[128];
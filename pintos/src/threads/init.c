@@ -21,7 +21,9 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/tlbbench.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -57,8 +59,17 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* CPUID feature flags for 4 MB pages and global pages, and the
+   CR4 bits that turn them on. */
+#define CPUID_PSE (1 << 3)
+#define CPUID_PGE (1 << 13)
+#define CR4_PSE 0x10
+#define CR4_PGE 0x80
+
 static void bss_init (void);
 static void paging_init (void);
+static uint32_t cpuid_features (void);
+static void cr4_set (uint32_t bits);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -97,6 +108,7 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  slab_init ();
   paging_init ();
 
   /* Segmentation. */
@@ -112,6 +124,7 @@ main (void)
   input_init ();
 #ifdef USERPROG
   exception_init ();
+  process_init ();
   syscall_init ();
 #endif
 
@@ -153,13 +166,28 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports 4 MB pages, each aligned 4 MB of physical
+   memory is mapped with a single page directory entry instead of
+   a page table of 1,024 entries, so that the kernel needs far
+   fewer TLB entries to reach all of memory.  The 4 MB that hold
+   the kernel's code, which must be read-only, and any partial
+   4 MB at the end of memory still use page tables.
+
+   The kernel mapping is the same in every page directory, so it
+   is marked global, and global pages are turned on if the CPU
+   supports them: then the TLB keeps its entries for kernel pages
+   when CR3 is reloaded on a switch between processes.  See
+   [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpuid_features ();
+  bool large_pages = (features & CPUID_PSE) != 0;
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,21 +199,59 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large_pages && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr >= &_end_kernel_text || vaddr + PTSPAN <= &_start))
+        {
+          pd[pde_idx] = pde_create_large (vaddr) | PTE_G;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | PTE_G;
     }
 
+  /* 4 MB pages have to be turned on before the CPU sees the page
+     directory, or it would take their entries for pointers to
+     page tables.  See [IA32-v3a] 3.6.1 "Paging Options". */
+  if (large_pages)
+    cr4_set (CR4_PSE);
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  /* Turn on global pages, if CPUID says the CPU has them.  See
+     [IA32-v2a] "CPUID" and [IA32-v3a] 2.5 "Control Registers". */
+  if (features & CPUID_PGE)
+    cr4_set (CR4_PGE);
+}
+
+/* Sets BITS in control register CR4. */
+static void
+cr4_set (uint32_t bits)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4 | bits) : "memory");
+}
+
+/* Returns the feature flags that CPUID reports in EDX. */
+static uint32_t
+cpuid_features (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -259,6 +325,8 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-al"))
+        process_arg_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -309,6 +377,7 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"tlbbench", 1, tlbbench_run},
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
@@ -357,6 +426,7 @@ usage (void)
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  tlbbench           Time TLB misses with 4 MB and 4 kB pages.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -381,6 +451,7 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -al=COUNT          Limit program arguments to COUNT pages.\n"
 #endif
           );
   shutdown_power_off ();
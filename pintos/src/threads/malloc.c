@@ -32,7 +32,16 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each descriptor counts its arenas and in-use blocks, along
+   with their high-water marks, and malloc_print_stats() reports
+   them at shutdown.  If the kernel is built with MALLOC_DEBUG
+   defined, every block additionally carries a small tag that
+   records which call site allocated it, and malloc_print_stats()
+   lists the call sites that still have blocks outstanding.
+   Feed the addresses it prints to the `backtrace' utility to
+   turn them into function names. */
 
 /* Descriptor. */
 struct desc
@@ -41,6 +50,12 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by LOCK. */
+    size_t arena_cnt;           /* Arenas currently allocated. */
+    size_t arena_peak;          /* High-water mark of ARENA_CNT. */
+    size_t in_use;              /* Blocks currently allocated. */
+    size_t in_use_peak;         /* High-water mark of IN_USE. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -64,6 +79,42 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Big block statistics, protected by BIG_LOCK. */
+static struct lock big_lock;
+static size_t big_cnt;          /* Big blocks currently allocated. */
+static size_t big_pages;        /* Pages in those big blocks. */
+static size_t big_pages_peak;   /* High-water mark of BIG_PAGES. */
+
+#ifdef MALLOC_DEBUG
+/* A call site that allocates memory. */
+struct alloc_site
+{
+    void *caller;               /* Return address of the allocation. */
+    size_t blocks;              /* Blocks outstanding. */
+    size_t bytes;               /* Bytes requested for those blocks. */
+};
+
+/* Tag placed at the start of each block in MALLOC_DEBUG mode.
+   The caller's pointer follows it. */
+struct block_tag
+{
+    struct alloc_site *site;    /* Allocating call site. */
+    size_t size;                /* Bytes requested by the caller. */
+};
+
+/* Call sites, protected by SITE_LOCK.  Allocations from call
+   sites beyond the first MAX_SITES are charged to the last
+   entry, whose CALLER is a null pointer. */
+#define MAX_SITES 64
+static struct alloc_site sites[MAX_SITES];
+static struct lock site_lock;
+
+static void *tag_block (struct block_tag *, size_t size, void *caller);
+static struct block_tag *untag_block (void *);
+#endif
+
+static void *do_malloc (size_t size);
+static void do_free (void *p);
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -82,12 +133,33 @@ malloc_init (void)
         list_init (&d->free_list);
         lock_init (&d->lock);
     }
+    lock_init (&big_lock);
+#ifdef MALLOC_DEBUG
+    lock_init (&site_lock);
+#endif
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
     void *
 malloc (size_t size) 
+{
+#ifdef MALLOC_DEBUG
+    if (size == 0)
+        return NULL;
+    return tag_block (do_malloc (size + sizeof (struct block_tag)), size,
+            __builtin_return_address (0));
+#else
+    return do_malloc (size);
+#endif
+}
+
+/* Obtains and returns a new block of at least SIZE bytes from
+   the descriptors or, for a big block, directly from the page
+   allocator.  Returns a null pointer if memory is not
+   available. */
+    static void *
+do_malloc (size_t size) 
 {
     struct desc *d;
     struct block *b;
@@ -116,6 +188,13 @@ malloc (size_t size)
         a->magic = ARENA_MAGIC;
         a->desc = NULL;
         a->free_cnt = page_cnt;
+
+        lock_acquire (&big_lock);
+        big_cnt++;
+        big_pages += page_cnt;
+        if (big_pages > big_pages_peak)
+            big_pages_peak = big_pages;
+        lock_release (&big_lock);
         return a + 1;
     }
 
@@ -143,12 +222,16 @@ malloc (size_t size)
             struct block *b = arena_to_block (a, i);
             list_push_back (&d->free_list, &b->free_elem);
         }
+        if (++d->arena_cnt > d->arena_peak)
+            d->arena_peak = d->arena_cnt;
     }
 
     /* Get a block from free list and return it. */
     b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
     a = block_to_arena (b);
     a->free_cnt--;
+    if (++d->in_use > d->in_use_peak)
+        d->in_use_peak = d->in_use;
     lock_release (&d->lock);
     return b;
 }
@@ -167,7 +250,12 @@ calloc (size_t a, size_t b)
         return NULL;
 
     /* Allocate and zero memory. */
-    p = malloc (size);
+#ifdef MALLOC_DEBUG
+    p = tag_block (do_malloc (size + sizeof (struct block_tag)), size,
+            __builtin_return_address (0));
+#else
+    p = do_malloc (size);
+#endif
     if (p != NULL)
         memset (p, 0, size);
 
@@ -178,11 +266,16 @@ calloc (size_t a, size_t b)
     static size_t
 block_size (void *block) 
 {
+#ifdef MALLOC_DEBUG
+    /* Only the bytes the caller asked for are theirs to copy. */
+    return ((struct block_tag *) block - 1)->size;
+#else
     struct block *b = block;
     struct arena *a = block_to_arena (b);
     struct desc *d = a->desc;
 
     return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+#endif
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +294,13 @@ realloc (void *old_block, size_t new_size)
     }
     else 
     {
-        void *new_block = malloc (new_size);
+        void *new_block;
+#ifdef MALLOC_DEBUG
+        new_block = tag_block (do_malloc (new_size + sizeof (struct block_tag)),
+                new_size, __builtin_return_address (0));
+#else
+        new_block = do_malloc (new_size);
+#endif
         if (old_block != NULL && new_block != NULL)
         {
             size_t old_size = block_size (old_block);
@@ -217,6 +316,18 @@ realloc (void *old_block, size_t new_size)
    malloc(), calloc(), or realloc(). */
     void
 free (void *p) 
+{
+#ifdef MALLOC_DEBUG
+    if (p != NULL)
+        p = untag_block (p);
+#endif
+    do_free (p);
+}
+
+/* Returns block P, which must have been obtained from
+   do_malloc(), to its descriptor or to the page allocator. */
+    static void
+do_free (void *p) 
 {
     if (p != NULL)
     {
@@ -237,6 +348,7 @@ free (void *p)
 
             /* Add block to free list. */
             list_push_front (&d->free_list, &b->free_elem);
+            d->in_use--;
 
             /* If the arena is now entirely unused, free it. */
             if (++a->free_cnt >= d->blocks_per_arena) 
@@ -250,6 +362,7 @@ free (void *p)
                     list_remove (&b->free_elem);
                 }
                 palloc_free_page (a);
+                d->arena_cnt--;
             }
 
             lock_release (&d->lock);
@@ -257,12 +370,91 @@ free (void *p)
         else
         {
             /* It's a big block.  Free its pages. */
+            lock_acquire (&big_lock);
+            big_cnt--;
+            big_pages -= a->free_cnt;
+            lock_release (&big_lock);
             palloc_free_multiple (a, a->free_cnt);
             return;
         }
     }
 }
 
+/* Prints statistics for each descriptor that has ever been
+   used, and for big blocks. */
+    void
+malloc_print_stats (void) 
+{
+    struct desc *d;
+
+    for (d = descs; d < descs + desc_cnt; d++)
+        if (d->arena_peak > 0)
+            printf ("Malloc: %zu-byte blocks: %zu in use (peak %zu), "
+                    "%zu arenas (peak %zu)\n",
+                    d->block_size, d->in_use, d->in_use_peak,
+                    d->arena_cnt, d->arena_peak);
+    printf ("Malloc: big blocks: %zu in use, %zu pages (peak %zu)\n",
+            big_cnt, big_pages, big_pages_peak);
+
+#ifdef MALLOC_DEBUG
+    {
+        struct alloc_site *s;
+
+        for (s = sites; s < sites + MAX_SITES; s++)
+            if (s->blocks > 0)
+                printf ("Malloc: %zu blocks (%zu bytes) outstanding from %p\n",
+                        s->blocks, s->bytes, s->caller);
+    }
+#endif
+}
+
+#ifdef MALLOC_DEBUG
+/* Charges TAG, a block just obtained from do_malloc() for a
+   SIZE-byte request made from CALLER, to CALLER's call site.
+   Returns the caller's part of the block, which follows the
+   tag, or a null pointer if TAG is null. */
+    static void *
+tag_block (struct block_tag *tag, size_t size, void *caller)
+{
+    struct alloc_site *s;
+
+    if (tag == NULL)
+        return NULL;
+
+    lock_acquire (&site_lock);
+    for (s = sites; s < sites + MAX_SITES - 1; s++)
+        if (s->caller == caller || s->caller == NULL)
+            break;
+    if (s < sites + MAX_SITES - 1)
+        s->caller = caller;
+    s->blocks++;
+    s->bytes += size;
+    lock_release (&site_lock);
+
+    tag->site = s;
+    tag->size = size;
+    return tag + 1;
+}
+
+/* Releases the call site charge for block P, which was returned
+   by tag_block(), and returns P's tag, which is the start of the
+   block as returned by do_malloc(). */
+    static struct block_tag *
+untag_block (void *p)
+{
+    struct block_tag *tag = (struct block_tag *) p - 1;
+    struct alloc_site *s = tag->site;
+
+    ASSERT (s >= sites && s < sites + MAX_SITES);
+    lock_acquire (&site_lock);
+    ASSERT (s->blocks > 0);
+    s->blocks--;
+    s->bytes -= tag->size;
+    lock_release (&site_lock);
+    return tag;
+}
+#endif
+
 /* Returns the arena that block B is inside. */
     static struct arena *
 block_to_arena (struct block *b)
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +24,21 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool also keeps a few free pages that have already been
+   zeroed, filled in by the idle thread through palloc_zero_idle(),
+   so that a request for a single zeroed page does not have to
+   clear it while the caller waits.  Those pages are marked in use
+   in the pool's bitmap, but are counted as free; they go back to
+   the bitmap if an allocation would otherwise fail.  The idle
+   thread only runs when no other thread is ready, so this relies
+   on threads that wait, such as those in timer_sleep(), blocking
+   rather than yielding in a loop; palloc_print_stats() shows how
+   many requests it served. */
+
+/* Number of zeroed pages kept ready in each pool. */
+#define ZEROED_MAX 32
 
 /* A memory pool. */
 struct pool
@@ -31,6 +46,23 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Statistics.  Updated with interrupts off, because pages
+       are freed from thread_schedule_tail(), where we cannot
+       acquire a lock. */
+    size_t used_cnt;                    /* Pages currently allocated. */
+    size_t used_peak;                   /* High-water mark of USED_CNT. */
+    long long alloc_cnt;                /* Successful allocations. */
+    long long fail_cnt;                 /* Failed allocations. */
+    long long zero_hits;                /* PAL_ZERO pages already zeroed. */
+    long long zero_misses;              /* PAL_ZERO pages zeroed on demand. */
+
+    /* Free pages zeroed ahead of time.  Accessed with interrupts
+       off, like the statistics, since palloc_free_multiple() does
+       not take the lock. */
+    void *zeroed[ZEROED_MAX];
+    size_t zeroed_cnt;
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +71,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
         const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *take_zeroed (struct pool *);
+static bool release_zeroed (struct pool *);
+static bool zero_page (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -73,14 +108,36 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
     struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
     void *pages;
     size_t page_idx;
+    enum intr_level old_level;
 
     if (page_cnt == 0)
         return NULL;
 
+    if (page_cnt == 1 && (flags & PAL_ZERO))
+    {
+        pages = take_zeroed (pool);
+        if (pages != NULL)
+            return pages;
+    }
+
     lock_acquire (&pool->lock);
     page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+    if (page_idx == BITMAP_ERROR && release_zeroed (pool))
+        page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
     lock_release (&pool->lock);
 
+    old_level = intr_disable ();
+    if (page_idx != BITMAP_ERROR)
+    {
+        pool->alloc_cnt++;
+        pool->used_cnt += page_cnt;
+        if (pool->used_cnt > pool->used_peak)
+            pool->used_peak = pool->used_cnt;
+    }
+    else
+        pool->fail_cnt++;
+    intr_set_level (old_level);
+
     if (page_idx != BITMAP_ERROR)
         pages = pool->base + PGSIZE * page_idx;
     else
@@ -113,12 +170,25 @@ palloc_get_page (enum palloc_flags flags)
     return palloc_get_multiple (flags, 1);
 }
 
+/* Zeroes a free page, if some pool has fewer than ZEROED_MAX
+   zeroed pages ready, for a later palloc_get_page(PAL_ZERO) to
+   take without waiting for it to be cleared.  Returns true if a
+   page was zeroed, false if there was nothing to do or the pool
+   was busy.  Never blocks, so that the idle thread can call it
+   when no other thread is ready to run. */
+    bool
+palloc_zero_idle (void)
+{
+    return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
     void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
     struct pool *pool;
     size_t page_idx;
+    enum intr_level old_level;
 
     ASSERT (pg_ofs (pages) == 0);
     if (pages == NULL || page_cnt == 0)
@@ -139,6 +209,10 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
     ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
     bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+    old_level = intr_disable ();
+    pool->used_cnt -= page_cnt;
+    intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,6 +222,28 @@ palloc_free_page (void *page)
     palloc_free_multiple (page, 1);
 }
 
+/* Prints statistics for POOL. */
+    static void
+print_pool_stats (struct pool *pool)
+{
+    size_t page_cnt = bitmap_size (pool->used_map);
+
+    printf ("Palloc: %s: %zu of %zu pages free (peak %zu used), "
+            "%lld allocations, %lld failures\n",
+            pool->name, page_cnt - pool->used_cnt, page_cnt, pool->used_peak,
+            pool->alloc_cnt, pool->fail_cnt);
+    printf ("Palloc: %s: %lld of %lld zeroed pages taken pre-zeroed\n",
+            pool->name, pool->zero_hits, pool->zero_hits + pool->zero_misses);
+}
+
+/* Prints page allocator statistics for both pools. */
+    void
+palloc_print_stats (void) 
+{
+    print_pool_stats (&kernel_pool);
+    print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
     static void
@@ -167,6 +263,82 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
     lock_init (&p->lock);
     p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
     p->base = base + bm_pages * PGSIZE;
+    p->name = name;
+}
+
+/* Takes a page from POOL's zeroed pages and returns it, counted
+   as allocated, or returns a null pointer if there are none. */
+    static void *
+take_zeroed (struct pool *pool)
+{
+    void *page = NULL;
+    enum intr_level old_level;
+
+    old_level = intr_disable ();
+    if (pool->zeroed_cnt > 0)
+    {
+        page = pool->zeroed[--pool->zeroed_cnt];
+        pool->zero_hits++;
+        pool->alloc_cnt++;
+        if (++pool->used_cnt > pool->used_peak)
+            pool->used_peak = pool->used_cnt;
+    }
+    else
+        pool->zero_misses++;
+    intr_set_level (old_level);
+
+    return page;
+}
+
+/* Marks all of POOL's zeroed pages free in its bitmap and forgets
+   them.  Returns true if there were any.  POOL's lock must be
+   held. */
+    static bool
+release_zeroed (struct pool *pool)
+{
+    bool released = false;
+    enum intr_level old_level;
+
+    ASSERT (lock_held_by_current_thread (&pool->lock));
+
+    old_level = intr_disable ();
+    while (pool->zeroed_cnt > 0)
+    {
+        void *page = pool->zeroed[--pool->zeroed_cnt];
+        bitmap_reset (pool->used_map, pg_no (page) - pg_no (pool->base));
+        released = true;
+    }
+    intr_set_level (old_level);
+
+    return released;
+}
+
+/* Zeroes one of POOL's free pages and adds it to its zeroed
+   pages, if it has room for more and its lock is free.  Returns
+   true if successful, false otherwise. */
+    static bool
+zero_page (struct pool *pool)
+{
+    size_t page_idx;
+    void *page;
+    enum intr_level old_level;
+
+    if (pool->zeroed_cnt >= ZEROED_MAX || !lock_try_acquire (&pool->lock))
+        return false;
+    page_idx = bitmap_scan_and_flip (pool->used_map, 0, 1, false);
+    lock_release (&pool->lock);
+    if (page_idx == BITMAP_ERROR)
+        return false;
+
+    /* Only the idle thread adds pages, so there is still room. */
+    page = pool->base + PGSIZE * page_idx;
+    memset (page, 0, PGSIZE);
+
+    old_level = intr_disable ();
+    pool->zeroed[pool->zeroed_cnt++] = page;
+    intr_set_level (old_level);
+
+    return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
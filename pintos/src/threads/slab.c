@@ -0,0 +1,252 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab cache.
+
+   Each slab is one page.  The page begins with a `struct slab'
+   header, which is followed by a stack of the indexes of the
+   slab's free objects, which is followed by the objects
+   themselves:
+
+   4 kB +---------------------------------+
+        |           object N-1            |
+        |                :                |
+        |            object 1             |
+        |            object 0             |
+        +---------------------------------+ <- obj_ofs
+        |   free index stack (N entries)  |
+        +---------------------------------+
+        |          struct slab            |
+   0 kB +---------------------------------+
+
+   Keeping the free list out of line, rather than threading it
+   through the free objects as malloc() does, means a free object
+   needs no minimum size, so objects smaller than a pointer pack
+   as tightly as larger ones.
+
+   A cache keeps the slabs that have at least one free object on
+   its `partial' list.  Full slabs are on no list at all; the
+   slab that owns an object is always found by rounding the
+   object's address down to a page boundary.  When a slab becomes
+   entirely free, it is returned to the page allocator unless it
+   is the cache's only partial slab, which avoids thrashing a page
+   back and forth when a single object is repeatedly allocated
+   and freed. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header. */
+struct slab
+{
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's partial list. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free_idx[];        /* Indexes of free objects. */
+};
+
+/* List of all caches, for statistics. */
+static struct list all_caches;
+static struct lock all_caches_lock;
+
+static struct slab *slab_create (struct slab_cache *);
+static struct slab *obj_to_slab (struct slab_cache *, void *obj);
+
+/* Initializes the slab allocator. */
+    void
+slab_init (void) 
+{
+    list_init (&all_caches);
+    lock_init (&all_caches_lock);
+}
+
+/* Initializes cache C to hand out objects of SIZE bytes each,
+   aligned on ALIGN-byte boundaries, naming it NAME for debugging
+   purposes.  ALIGN must be a power of 2, or 0 to request pointer
+   alignment.  If CTOR is nonnull, it is called on each object
+   handed out by slab_alloc() before it is returned. */
+    void
+slab_cache_init (struct slab_cache *c, const char *name,
+        size_t size, size_t align, slab_ctor_func *ctor)
+{
+    size_t n;
+
+    ASSERT (c != NULL);
+    ASSERT (size > 0);
+    if (align == 0)
+        align = sizeof (void *);
+    ASSERT ((align & (align - 1)) == 0);
+
+    c->name = name;
+    c->align = align;
+    c->obj_size = ROUND_UP (size, align);
+    c->ctor = ctor;
+
+    /* Find the largest number of objects that fit in a page
+       along with the header and the free index stack. */
+    n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+    while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+                align) + n * c->obj_size > PGSIZE)
+        n--;
+    if (n == 0)
+        PANIC ("slab cache %s: %zu-byte objects do not fit in a page",
+                name, size);
+    c->objs_per_slab = n;
+    c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align);
+
+    list_init (&c->partial);
+    lock_init (&c->lock);
+    c->slab_cnt = c->slab_peak = 0;
+    c->in_use = c->in_use_peak = 0;
+
+    lock_acquire (&all_caches_lock);
+    list_push_back (&all_caches, &c->elem);
+    lock_release (&all_caches_lock);
+}
+
+/* Obtains and returns a new object from cache C.
+   Returns a null pointer if memory is not available. */
+    void *
+slab_alloc (struct slab_cache *c)
+{
+    struct slab *s;
+    void *obj;
+
+    lock_acquire (&c->lock);
+
+    /* If no slab has a free object, create a new slab. */
+    if (list_empty (&c->partial))
+    {
+        s = slab_create (c);
+        if (s == NULL)
+        {
+            lock_release (&c->lock);
+            return NULL;
+        }
+        list_push_front (&c->partial, &s->elem);
+        if (++c->slab_cnt > c->slab_peak)
+            c->slab_peak = c->slab_cnt;
+    }
+
+    /* Take an object from the first partial slab.  If that was
+       its last free object, the slab is now full. */
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+    obj = (uint8_t *) s + c->obj_ofs + s->free_idx[--s->free_cnt] * c->obj_size;
+    if (s->free_cnt == 0)
+        list_remove (&s->elem);
+    if (++c->in_use > c->in_use_peak)
+        c->in_use_peak = c->in_use;
+
+    lock_release (&c->lock);
+
+    if (c->ctor != NULL)
+        c->ctor (obj);
+    return obj;
+}
+
+/* Returns object OBJ, which must have been obtained from cache C
+   with slab_alloc(), to C.  A null OBJ is ignored. */
+    void
+slab_free (struct slab_cache *c, void *obj)
+{
+    struct slab *s;
+    size_t idx;
+
+    if (obj == NULL)
+        return;
+
+    s = obj_to_slab (c, obj);
+    idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+    /* Clear the object to help detect use-after-free bugs. */
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+    lock_acquire (&c->lock);
+
+    /* A full slab becomes partial again. */
+    if (s->free_cnt == 0)
+        list_push_front (&c->partial, &s->elem);
+    ASSERT (s->free_cnt < c->objs_per_slab);
+    s->free_idx[s->free_cnt++] = idx;
+    c->in_use--;
+
+    /* Give an entirely free slab back to the page allocator,
+       unless it is the only one we have left. */
+    if (s->free_cnt == c->objs_per_slab
+        && list_front (&c->partial) != list_back (&c->partial))
+    {
+        list_remove (&s->elem);
+        s->magic = 0;
+        palloc_free_page (s);
+        c->slab_cnt--;
+    }
+
+    lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache.  Takes no locks, because
+   it may be called while shutting down after a kernel panic. */
+    void
+slab_print_stats (void) 
+{
+    struct list_elem *e;
+
+    for (e = list_begin (&all_caches); e != list_end (&all_caches);
+            e = list_next (e))
+    {
+        struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+        printf ("Slab: %s: %zu-byte objects: %zu in use (peak %zu), "
+                "%zu slabs (peak %zu)\n",
+                c->name, c->obj_size, c->in_use, c->in_use_peak,
+                c->slab_cnt, c->slab_peak);
+    }
+}
+
+/* Allocates and initializes a new, entirely free slab for cache
+   C.  Returns a null pointer if memory is not available. */
+    static struct slab *
+slab_create (struct slab_cache *c)
+{
+    struct slab *s = palloc_get_page (0);
+    size_t i;
+
+    if (s == NULL)
+        return NULL;
+
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->free_cnt = c->objs_per_slab;
+
+    /* Push the indexes in reverse order, so that objects are
+       handed out from the start of the page first. */
+    for (i = 0; i < c->objs_per_slab; i++)
+        s->free_idx[i] = c->objs_per_slab - 1 - i;
+    return s;
+}
+
+/* Returns the slab that object OBJ, which belongs to cache C, is
+   inside. */
+    static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj)
+{
+    struct slab *s = pg_round_down (obj);
+
+    /* Check that the slab is valid and belongs to C. */
+    ASSERT (s->magic == SLAB_MAGIC);
+    ASSERT (s->cache == c);
+
+    /* Check that the object is properly aligned for the slab. */
+    ASSERT (pg_ofs (obj) >= c->obj_ofs);
+    ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+    return s;
+}
@@ -0,0 +1,48 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Slab allocator for fixed-size kernel objects.
+
+   A slab cache hands out objects of one exact size and
+   alignment.  Each "slab" is a single page obtained from the
+   page allocator, holding a small header followed by as many
+   objects as fit.  Unlike malloc(), which rounds every request
+   up to a power of 2, a cache packs objects at their natural
+   size, and each cache has its own lock, so allocations of
+   unrelated objects do not contend with each other. */
+
+/* Initializes object OBJ, freshly handed out by slab_alloc(). */
+typedef void slab_ctor_func (void *obj);
+
+/* A cache of objects of a single size. */
+struct slab_cache
+{
+    const char *name;           /* Name (for debugging purposes). */
+    size_t obj_size;            /* Object size, rounded up to ALIGN. */
+    size_t align;               /* Object alignment. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in a slab. */
+    slab_ctor_func *ctor;       /* Constructor, or null. */
+    struct list partial;        /* Slabs with at least one free object. */
+    struct lock lock;           /* Lock. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics, protected by LOCK. */
+    size_t slab_cnt;            /* Slabs currently allocated. */
+    size_t slab_peak;           /* High-water mark of SLAB_CNT. */
+    size_t in_use;              /* Objects currently allocated. */
+    size_t in_use_peak;         /* High-water mark of IN_USE. */
+};
+
+void slab_init (void);
+void slab_print_stats (void);
+void slab_cache_init (struct slab_cache *, const char *name,
+                      size_t size, size_t align, slab_ctor_func *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+
+#endif /* threads/slab.h */
@@ -28,6 +28,18 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Pages of threads that have died, kept for thread_create() to
+   reuse so that short-lived threads need not go through the page
+   allocator.  A page is not zeroed for reuse, or when it first
+   comes from the page allocator: init_thread() clears the struct
+   thread at its start, and nothing relies on the rest of it, the
+   kernel stack, starting out zeroed.  Dying threads are added by
+   thread_schedule_tail(), with interrupts off, so accesses are
+   protected by turning interrupts off. */
+#define THREAD_CACHE_CNT 8
+static struct thread *thread_cache[THREAD_CACHE_CNT];
+static size_t thread_cache_cnt;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -67,6 +79,8 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
@@ -176,7 +190,7 @@ thread_create (const char *name, int priority,
     ASSERT (function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page (PAL_ZERO);
+    t = thread_page_get ();
     if (t == NULL)
         return TID_ERROR;
 
@@ -406,6 +420,16 @@ idle (void *idle_started_ UNUSED)
         intr_disable ();
         thread_block ();
 
+        /* Nobody else can run, so zero free pages for later
+           palloc_get_page(PAL_ZERO) calls, one at a time so that
+           a thread woken meanwhile need not wait long. */
+        intr_enable ();
+        while (list_empty (&ready_list) && palloc_zero_idle ())
+            continue;
+        intr_disable ();
+        if (!list_empty (&ready_list))
+            continue;
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the
@@ -472,7 +496,9 @@ init_thread (struct thread *t, const char *name, int priority)
 
     // lists
     list_init(&t->children);
+    list_init(&t->exited);
     list_init(&t->files);
+    cond_init(&t->child_exit);
 
     // starting fd
     t->fd = 2;
@@ -484,7 +510,6 @@ init_thread (struct thread *t, const char *name, int priority)
     t->program = NULL;
     // no child struct allocated yet
     t->cp      = NULL;
-    t->start   = NULL;
 
     list_push_back (&all_list, &t->allelem);
 }
@@ -502,6 +527,36 @@ alloc_frame (struct thread *t, size_t size)
     return t->stack;
 }
 
+/* Returns a page for a new thread, from the thread cache if it
+   has one, or a null pointer if none is available. */
+    static struct thread *
+thread_page_get (void)
+{
+    struct thread *t = NULL;
+    enum intr_level old_level;
+
+    old_level = intr_disable ();
+    if (thread_cache_cnt > 0)
+        t = thread_cache[--thread_cache_cnt];
+    intr_set_level (old_level);
+
+    return t != NULL ? t : palloc_get_page (0);
+}
+
+/* Returns the page of T, which is dead, to the thread cache, or
+   to the page allocator if the cache is full.  Interrupts must
+   be off. */
+    static void
+thread_page_put (struct thread *t)
+{
+    ASSERT (intr_get_level () == INTR_OFF);
+
+    if (thread_cache_cnt < THREAD_CACHE_CNT)
+        thread_cache[thread_cache_cnt++] = t;
+    else
+        palloc_free_page (t);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -554,11 +609,12 @@ thread_schedule_tail (struct thread *prev)
        thread.  This must happen late so that thread_exit() doesn't
        pull out the rug under itself.  (We don't free
        initial_thread because its memory was not obtained via
-       palloc().) */
+       palloc().)  Its page goes to the thread cache for the next
+       thread_create(). */
     if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
         ASSERT (prev != cur);
-        palloc_free_page (prev);
+        thread_page_put (prev);
     }
 }
 
@@ -602,20 +658,3 @@ allocate_tid (void)
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
-
-
-
-struct thread* thread_get(tid_t tid) {
-    struct list_elem* e;
-    struct thread*    t;
-    for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-        t = list_entry(e, struct thread, allelem);
-        if (t->tid == tid)
-            return t;
-    }
-    return NULL;
-}
-
-
-
-
@@ -86,14 +86,18 @@ typedef tid_t pid_t;
    blocked state is on a semaphore wait list. */
 
 
-// child struct
+// exit status record shared by a child process and its parent.
+// each holds a reference, and the record is freed once both have
+// let go: the child when it exits, the parent when it waits for the
+// child or exits itself.  protected by process.c's process_lock
 struct child_t {
     pid_t  pid;
-    bool   wait;
-    bool   exit;
-    int    ret;
-    struct list_elem elem;
-    struct semaphore exit_sema;
+    bool   exit;                    // has the child exited?
+    int    ret;                     // exit status, once exited
+    int    refs;                    // references held, 0 to 2
+    struct thread* parent;          // parent, NULL once it exits
+    struct list_elem elem;          // in parent's children list
+    struct list_elem exit_elem;     // in parent's exited list
 };
 
 
@@ -108,14 +112,16 @@ struct thread
     struct list_elem allelem;       /* List element for all threads list. */
 
     struct list files;              /* list of files */
-    struct list children;           /* list of children */
+    struct list children;           /* list of children not waited for */
+    struct list exited;             /* those children that have exited */
+    struct condition child_exit;    /* signaled when a child exits */
 
-    struct child_t** start;         /* pass cp to process_execute */
     struct child_t* cp;             /* pointer to own child struct */
     tid_t  parent;                  /* parent thread id */
     int    fd;                      /* next available file descriptor */
 
     struct file*  program;          /* executable file */
+    int    log_depth;               /* file system log operations begun */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;          /* List element. */
@@ -165,7 +171,6 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-struct thread* thread_get(tid_t);
 
 
 
@@ -0,0 +1,174 @@
+#include "threads/tlbbench.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* TLB microbenchmark.
+
+   Reads one byte from each page of up to MAX_SPAN bytes of
+   physical memory, through the kernel's mapping of it, so that
+   nearly every read needs a different TLB entry.  It does so
+   first through init_page_dir, which maps that memory with 4 MB
+   pages if the CPU supports them, and then through a copy of
+   init_page_dir that maps the same memory with 4 kB pages, the
+   way the kernel did before, and prints the cycles per read for
+   each.  Times are taken from the CPU's time-stamp counter.
+
+   Interrupts are off throughout, so that no thread switch can
+   change page directories in the middle. */
+
+/* Most bytes of memory read. */
+#define MAX_SPAN (16 * 1024 * 1024)
+
+/* Number of times each page is read. */
+#define PASSES 16
+
+/* CR4 bit that turns on global pages. */
+#define CR4_PGE 0x80
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Loads page directory PD into CR3 and flushes the whole TLB,
+   including global entries, which reloading CR3 leaves alone.
+   See [IA32-v3a] 3.12 "Translation Lookaside Buffers (TLBs)". */
+static void
+load_pd (uint32_t *pd)
+{
+  uint32_t cr4;
+
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  if (cr4 & CR4_PGE)
+    {
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 & ~CR4_PGE) : "memory");
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+    }
+}
+
+/* Reads a byte from each page of the SIZE bytes at START, PASSES
+   times over, and returns the cycles taken per read. */
+static uint64_t
+touch_pages (const uint8_t *start, size_t size)
+{
+  const volatile uint8_t *p;
+  uint64_t begin;
+  int pass;
+
+  begin = rdtsc ();
+  for (pass = 0; pass < PASSES; pass++)
+    for (p = start; p < start + size; p += PGSIZE)
+      (void) *p;
+  return (rdtsc () - begin) / (PASSES * (size / PGSIZE));
+}
+
+/* Frees PD, a copy of init_page_dir, and the page tables
+   it has that init_page_dir does not. */
+static void
+free_small_pd (uint32_t *pd)
+{
+  size_t i;
+
+  for (i = pd_no (PHYS_BASE); i < PGSIZE / sizeof *pd; i++)
+    if ((pd[i] & PTE_P) && !(pd[i] & PTE_PS)
+        && pd[i] != init_page_dir[i])
+      palloc_free_page (pde_get_pt (pd[i]));
+  palloc_free_page (pd);
+}
+
+/* Returns a copy of init_page_dir in which the 4 MB pages
+   mapping the SIZE bytes at START are replaced by page tables,
+   or a null pointer if memory runs out. */
+static uint32_t *
+make_small_pd (uint8_t *start, size_t size)
+{
+  uint32_t *pd = palloc_get_page (PAL_ZERO);
+  uint8_t *vaddr;
+
+  if (pd == NULL)
+    return NULL;
+  memcpy (pd, init_page_dir, PGSIZE);
+  for (vaddr = start; vaddr < start + size; vaddr += PTSPAN)
+    {
+      uint32_t *pt = palloc_get_page (0);
+      size_t i;
+
+      if (pt == NULL)
+        {
+          free_small_pd (pd);
+          return NULL;
+        }
+      for (i = 0; i < PTSPAN / PGSIZE; i++)
+        pt[i] = pte_create_kernel (vaddr + i * PGSIZE, true);
+      pd[pd_no (vaddr)] = pde_create (pt);
+    }
+  return pd;
+}
+
+/* Runs the benchmark. */
+void
+tlbbench_run (char **argv UNUSED)
+{
+  uint8_t *start = ptov (PTSPAN);
+  bool large = init_page_dir[pd_no (start)] & PTE_PS;
+  uint64_t large_cycles, small_cycles = 0;
+  uint32_t *small_pd = NULL;
+  enum intr_level old_level;
+  size_t size;
+
+  /* Skip the first 4 MB, which holds the kernel and is always
+     mapped with 4 kB pages. */
+  if (init_ram_pages * PGSIZE < 2 * PTSPAN)
+    {
+      printf ("tlbbench: needs at least 8 MB of RAM\n");
+      return;
+    }
+  size = (init_ram_pages * PGSIZE - PTSPAN) / PTSPAN * PTSPAN;
+  if (size > MAX_SPAN)
+    size = MAX_SPAN;
+  if (large)
+    {
+      small_pd = make_small_pd (start, size);
+      if (small_pd == NULL)
+        {
+          printf ("tlbbench: out of memory\n");
+          return;
+        }
+    }
+
+  old_level = intr_disable ();
+  load_pd (init_page_dir);
+  touch_pages (start, size);
+  large_cycles = touch_pages (start, size);
+  if (large)
+    {
+      load_pd (small_pd);
+      touch_pages (start, size);
+      small_cycles = touch_pages (start, size);
+      load_pd (init_page_dir);
+    }
+  intr_set_level (old_level);
+
+  printf ("tlbbench: read %zu pages %d times each\n", size / PGSIZE, PASSES);
+  if (large)
+    {
+      printf ("tlbbench: 4 MB pages: %llu cycles per read\n", large_cycles);
+      printf ("tlbbench: 4 kB pages: %llu cycles per read\n", small_cycles);
+      free_small_pd (small_pd);
+    }
+  else
+    printf ("tlbbench: 4 kB pages: %llu cycles per read "
+            "(CPU lacks 4 MB pages)\n", large_cycles);
+}
@@ -0,0 +1,8 @@
+#ifndef THREADS_TLBBENCH_H
+#define THREADS_TLBBENCH_H
+
+/* Kernel microbenchmark for the TLB cost of the kernel's mapping
+   of physical memory.  Run with the "tlbbench" action. */
+void tlbbench_run (char **argv);
+
+#endif /* threads/tlbbench.h */
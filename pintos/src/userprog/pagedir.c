@@ -1,49 +1,127 @@
 #include "userprog/pagedir.h"
+#include <debug.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/loader.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Number of page directory entries for user virtual memory. */
+#define USER_PDE_CNT (LOADER_PHYS_BASE / PTSPAN)
+
+/* Each page directory has a page of bookkeeping, apart from the
+   directory itself so that a directory needs no contiguous
+   pages.  It records which parts of the directory and of its
+   page tables have ever been filled in, so that
+   pagedir_destroy() need look only at those.  A range whose HI
+   is 0 is empty.  Ranges only grow: an entry cleared later is
+   still inside its range, and is skipped because it is not
+   present.  The range for a page table is only meaningful once
+   the table exists; it is set up when the table is created.
+
+   The directory points to its bookkeeping from entry INFO_PDE,
+   which maps the top 4 MB of kernel virtual memory.  Physical
+   memory is capped at 64 MB (see start.S), so the kernel never
+   maps that far, and the processor ignores everything in an
+   entry whose PTE_P bit is clear, as it is in the page-aligned
+   address of the bookkeeping. */
+struct pd_info
+  {
+    uint16_t pde_lo, pde_hi;    /* PDEs that may be present. */
+    struct
+      {
+        uint16_t lo, hi;        /* PTEs that may be present. */
+      }
+    pt[USER_PDE_CNT];           /* One per user PDE. */
+  };
+
+/* Page directory entry that points to the bookkeeping. */
+#define INFO_PDE (PGSIZE / sizeof (uint32_t) - 1)
+
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
+
+/* Returns PD's bookkeeping. */
+static inline struct pd_info *
+pd_info (uint32_t *pd)
+{
+  return (struct pd_info *) pd[INFO_PDE];
+}
+
+/* Widens the range from *LO to *HI to include IDX. */
+static inline void
+widen_range (uint16_t *lo, uint16_t *hi, size_t idx)
+{
+  if (*hi == 0 || idx < *lo)
+    *lo = idx;
+  if (idx >= *hi)
+    *hi = idx + 1;
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
-   allocation fails. */
+   allocation fails.
+
+   The kernel's entries, including any that map 4 MB pages, are
+   copied from init_page_dir.  Only the user part of the
+   directory and the directory range in the bookkeeping need
+   clearing, which is done here rather than by asking for
+   PAL_ZERO pages: that would clear the kernel part too whenever
+   the idle thread has no zeroed page ready, and takes pre-zeroed
+   pages that load() asks for to hold user data. */
 uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
-  if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+  struct pd_info *info = palloc_get_page (0);
+
+  if (pd == NULL || info == NULL)
+    {
+      palloc_free_page (info);
+      palloc_free_page (pd);
+      return NULL;
+    }
+
+  ASSERT (init_page_dir[INFO_PDE] == 0);
+  memset (pd, 0, USER_PDE_CNT * sizeof *pd);
+  memcpy (pd + USER_PDE_CNT, init_page_dir + USER_PDE_CNT,
+          (PGSIZE / sizeof *pd - USER_PDE_CNT) * sizeof *pd);
+  pd[INFO_PDE] = (uint32_t) info;
+  info->pde_lo = info->pde_hi = 0;
   return pd;
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  Only the parts of PD and its page tables that
+   have been filled in are examined, so the time this takes
+   depends on how much of the address space was used rather than
+   on its size. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
-  uint32_t *pde;
+  struct pd_info *info;
+  size_t pde;
 
   if (pd == NULL)
     return;
 
   ASSERT (pd != init_page_dir);
-  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+  info = pd_info (pd);
+  for (pde = info->pde_lo; pde < info->pde_hi; pde++)
+    if (pd[pde] & PTE_P) 
       {
-        uint32_t *pt = pde_get_pt (*pde);
-        uint32_t *pte;
+        uint32_t *pt = pde_get_pt (pd[pde]);
+        size_t pte;
         
-        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+        for (pte = info->pt[pde].lo; pte < info->pt[pde].hi; pte++)
+          if (pt[pte] & PTE_P) 
+            palloc_free_page (pte_get_page (pt[pte]));
         palloc_free_page (pt);
       }
+  palloc_free_page (info);
   palloc_free_page (pd);
 }
 
@@ -66,15 +144,20 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no (vaddr);
-  if (*pde == 0) 
+  if ((*pde & PTE_P) == 0) 
     {
       if (create)
         {
+          struct pd_info *info = pd_info (pd);
+          size_t idx = pd_no (vaddr);
+
           pt = palloc_get_page (PAL_ZERO);
           if (pt == NULL) 
             return NULL; 
       
           *pde = pde_create (pt);
+          widen_range (&info->pde_lo, &info->pde_hi, idx);
+          info->pt[idx].lo = info->pt[idx].hi = 0;
         }
       else
         return NULL;
@@ -110,8 +193,12 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 
   if (pte != NULL) 
     {
+      struct pd_info *info = pd_info (pd);
+      size_t pde = pd_no (upage);
+
       ASSERT ((*pte & PTE_P) == 0);
       *pte = pte_create_user (kpage, writable);
+      widen_range (&info->pt[pde].lo, &info->pt[pde].hi, pt_no (upage));
       return true;
     }
   else
@@ -152,7 +239,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +267,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,18 +296,22 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already there.  Loading it flushes the
+   TLB, except for the kernel's global mappings, so it is skipped
+   when nothing would change. */
 void
 pagedir_activate (uint32_t *pd) 
 {
   if (pd == NULL)
     pd = init_page_dir;
+  if (pd == active_pd ())
+    return;
 
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
@@ -243,21 +334,20 @@ active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the TLB
+   entry for the page that changed.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for VADDR if PD is the
+   active page directory.  (If PD is not active then its entries
+   are not in the TLB, so there is no need to invalidate
+   anything.)  Only that one entry is dropped, with INVLPG, rather
+   than the whole TLB.  See [IA32-v3a] 3.12 "Translation
+   Lookaside Buffers (TLBs)" and [IA32-v2a] "INVLPG". */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vaddr) 
 {
   if (active_pd () == pd) 
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
@@ -0,0 +1,174 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Anonymous pipes.
+
+   A pipe is a one-page ring buffer with a read end and a write
+   end, each of which may be held by any number of file
+   descriptors, in any number of processes.  Reading from an
+   empty pipe blocks until some data is written or until no
+   write ends remain, in which case it returns 0 to signal end of
+   file.  Writing to a full pipe blocks until the data is read;
+   writing to a pipe with no read ends left fails.  The pipe is
+   freed once both ends have been closed everywhere. */
+
+/* Bytes of data a pipe can hold. */
+#define PIPE_SIZE PGSIZE
+
+struct pipe
+  {
+    struct lock lock;           /* Protects all the members. */
+    struct condition readable;  /* Data written or last writer gone. */
+    struct condition writable;  /* Data read or last reader gone. */
+    uint8_t *buffer;            /* Ring buffer of PIPE_SIZE bytes. */
+    size_t start;               /* Index in BUFFER of first byte. */
+    size_t used;                /* Number of bytes in BUFFER. */
+    int readers;                /* Open read ends. */
+    int writers;                /* Open write ends. */
+  };
+
+/* Creates a pipe with one read end and one write end open.
+   Returns a null pointer if memory is not available. */
+struct pipe *
+pipe_create (void) 
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buffer = palloc_get_page (0);
+  if (p->buffer == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->start = p->used = 0;
+  p->readers = p->writers = 1;
+  return p;
+}
+
+/* Opens another read end of P, or another write end if WRITER is
+   true. */
+void
+pipe_open (struct pipe *p, bool writer) 
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITER is true, and
+   frees P if that was the last end open. */
+void
+pipe_close (struct pipe *p, bool writer) 
+{
+  bool last;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->readable, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->writable, &p->lock);
+    }
+  last = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (last)
+    {
+      palloc_free_page (p->buffer);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, waiting until at
+   least one byte is available unless SIZE is 0.  Returns the
+   number of bytes read, which is 0 at end of file, that is, when
+   P is empty and has no write ends open. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size) 
+{
+  uint8_t *buffer = buffer_;
+  size_t bytes_read = 0;
+
+  lock_acquire (&p->lock);
+  while (size > 0 && p->used == 0 && p->writers > 0)
+    cond_wait (&p->readable, &p->lock);
+
+  while (bytes_read < size && p->used > 0)
+    {
+      size_t chunk = PIPE_SIZE - p->start;
+      if (chunk > p->used)
+        chunk = p->used;
+      if (chunk > size - bytes_read)
+        chunk = size - bytes_read;
+      memcpy (buffer + bytes_read, p->buffer + p->start, chunk);
+      p->start = (p->start + chunk) % PIPE_SIZE;
+      p->used -= chunk;
+      bytes_read += chunk;
+    }
+  if (bytes_read > 0)
+    cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+
+  return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into P, waiting for readers to
+   make room as necessary.  Returns the number of bytes written,
+   which is less than SIZE only if the last read end is closed
+   partway through, or -1 if no read end was open to begin
+   with. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
+  size_t bytes_written = 0;
+  int result;
+
+  lock_acquire (&p->lock);
+  while (bytes_written < size && p->readers > 0)
+    {
+      size_t end, chunk;
+
+      if (p->used == PIPE_SIZE)
+        {
+          cond_wait (&p->writable, &p->lock);
+          continue;
+        }
+
+      /* Fill the free space up to the end of the buffer or the
+         start of the data, whichever comes first. */
+      end = (p->start + p->used) % PIPE_SIZE;
+      chunk = end >= p->start ? PIPE_SIZE - end : p->start - end;
+      if (chunk > size - bytes_written)
+        chunk = size - bytes_written;
+      memcpy (p->buffer + end, buffer + bytes_written, chunk);
+      p->used += chunk;
+      bytes_written += chunk;
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  result = bytes_written == 0 && size > 0 && p->readers == 0
+           ? -1 : (int) bytes_written;
+  lock_release (&p->lock);
+
+  return result;
+}
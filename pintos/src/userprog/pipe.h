@@ -0,0 +1,13 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool writer);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *, size_t);
+int pipe_write (struct pipe *, const void *, size_t);
+
+#endif /* userprog/pipe.h */
@@ -1,6 +1,7 @@
 #include "userprog/process.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <ohash.h>
 #include <round.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -13,45 +14,153 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
-void copyName(char* d, const char* s);
+struct args;
+static bool load (const struct args *args, void (**eip) (void), void **esp);
+static void image_init (void);
+
+// a command line split into the new process's arguments.  the parent
+// builds it in a single pass over the command line, and the child
+// copies it onto its stack without looking at the strings again
+struct args {
+    int     argc;       // number of arguments
+    size_t  size;       // bytes in strs, counting each null terminator
+    size_t* ofs;        // offset of each argument within strs
+    char*   strs;       // the arguments, one after another
+};
 
 struct exec_helper 
 {
     struct semaphore    load;
-    struct thread*      child;
+    struct thread*      parent;
     bool                success;
-    const char*         cmdline;
+    struct args*        args;
 };
 
+// -al: most pages of user stack the arguments may take up
+size_t process_arg_pages = 4;
+
 struct pfile {
     int     fd;
     struct  file* fp;
     struct  list_elem le;
 };
 
-void copyName(char* d, const char* s) {
-    ASSERT(d != NULL && s != NULL);
-    unsigned int offs = 0;
-    while(*s == ' ') s++;
-    if (*s) {
-        while(*s != ' ' && offs < 15) {
-            d[offs] = *s;
-            offs++;
-            s++;
-        }
+// cache of child structs shared between parent and child
+static struct slab_cache child_cache;
+
+// maps the pid of every child not yet waited for to its child struct,
+// so that wait doesn't have to search the parent's children
+static struct ohash child_map;
+
+// protects child_map and all child structs, children and exited lists
+static struct lock process_lock;
+
+// puts a fresh child struct in its not-yet-exited state, referenced
+// by both parent and child
+static void child_ctor(void* obj) {
+    struct child_t* c = obj;
+    c->exit   = false;
+    c->ret    = -1;
+    c->refs   = 2;
+    c->parent = NULL;
+}
+
+/* Initializes the process module. */
+void process_init (void) {
+    slab_cache_init(&child_cache, "child_t", sizeof(struct child_t), 0,
+                    child_ctor);
+    lock_init(&process_lock);
+    if (!ohash_init(&child_map))
+        PANIC ("can't create process table");
+    image_init();
+}
+
+// drops a reference to c, freeing it if that was the last one.
+// call with process_lock held
+static void child_release(struct child_t* c) {
+    ASSERT(c->refs > 0);
+    if (--c->refs == 0) slab_free(&child_cache, c);
+}
+
+// makes c one of its parent's children.  returns false if out of
+// memory.  call with process_lock held
+static bool child_add(struct child_t* c) {
+    if (ohash_insert(&child_map, c->pid, c) != NULL) return false;
+    list_push_back(&c->parent->children, &c->elem);
+    return true;
+}
+
+// removes c, which has exited, from its parent's children and returns
+// its exit status.  call with process_lock held
+static int child_reap(struct child_t* c) {
+    int ret = c->ret;
+    ASSERT(c->exit);
+    ohash_delete(&child_map, c->pid);
+    list_remove(&c->elem);
+    list_remove(&c->exit_elem);
+    child_release(c);
+    return ret;
+}
+
+// returns the current thread's child struct for the child with the
+// given pid, or NULL if it isn't our child or we already waited for
+// it.  call with process_lock held
+static struct child_t* getChild(pid_t pid) {
+    struct child_t* c = ohash_find(&child_map, pid);
+    return c && c->parent == thread_current() ? c : NULL;
+}
+
+// bytes of user stack that args takes up once it's laid out for main:
+// the strings, padding to a word, argv[] with its null, then argv,
+// argc and the fake return address
+static size_t args_frame_size(const struct args* args) {
+    return ROUND_UP(args->size, sizeof(void*))
+         + (args->argc + 1 + 3) * sizeof(void*);
+}
+
+// splits cmdline into words at whitespace, copying each word once into
+// a new args.  returns NULL if out of memory or if the arguments
+// wouldn't fit in process_arg_pages pages of stack.  free with free()
+static struct args* args_parse(const char* cmdline) {
+    size_t len = strlen(cmdline);
+    size_t max_argc = (len + 1) / 2;    // each word but the last needs
+                                        // a space after it
+    struct args* args;
+    char* dst;
+
+    args = malloc(sizeof *args + max_argc * sizeof *args->ofs + len + 1);
+    if (!args) return NULL;
+    args->ofs  = (size_t*)(args + 1);
+    args->strs = (char*)(args->ofs + max_argc);
+    args->argc = 0;
+
+    dst = args->strs;
+    for (;;) {
+        while (isspace(*cmdline)) cmdline++;
+        if (*cmdline == '\0') break;
+        args->ofs[args->argc++] = dst - args->strs;
+        while (*cmdline != '\0' && !isspace(*cmdline)) *dst++ = *cmdline++;
+        *dst++ = '\0';
+    }
+    args->size = dst - args->strs;
+
+    if (args_frame_size(args) > process_arg_pages * PGSIZE) {
+        free(args);
+        return NULL;
     }
-    d[offs] = '\0';
+    return args;
 }
 
 
@@ -61,50 +170,64 @@ void copyName(char* d, const char* s) {
    thread id, or TID_ERROR if the thread cannot be created. */
 tid_t process_execute (const char* fName)
 {
-    // if (!validate_string(fName))
-        // return TID_ERROR;
+    tid_t tid;
+    process_execute_many(&fName, 1, &tid);
+    return tid;
+}
 
-    if (thread_current()->tid > 30) return -1;
-    char pName[16];
-    struct exec_helper eh;
-    tid_t tid = TID_ERROR;
+/* Starts CNT user programs, one for each command line in CMDLINES,
+   and stores each new process's thread id, or TID_ERROR if it
+   could not be started, into the corresponding element of TIDS.
+   All the threads are created before any is waited for, so their
+   loads proceed at the same time and this takes about as long as
+   the slowest of them.  Returns the number of processes started.
+   CNT must not exceed PROCESS_SPAWN_MAX. */
+int process_execute_many (const char** cmdlines, int cnt, tid_t* tids)
+{
+    struct exec_helper* ehs;
     struct thread* t = thread_current();
+    int started = 0;
+    int i;
 
-    // init exec helper
-    eh.cmdline = malloc(strlen(fName)+1);
-    strlcpy(eh.cmdline, fName, strlen(fName)+1);
-
-    sema_init(&eh.load, 0);
-    eh.success = false;
-
-    // copy thread name
-    copyName(pName, fName);
+    ASSERT(cnt >= 0 && cnt <= PROCESS_SPAWN_MAX);
+    ehs = malloc(cnt * sizeof *ehs);
+    if (!ehs) {
+        for (i = 0; i < cnt; i++) tids[i] = TID_ERROR;
+        return 0;
+    }
 
-    /* Create a new thread to execute FILE_NAME. */
-    tid = thread_create (pName, PRI_DEFAULT, start_process, &eh);
-    struct thread* c = thread_get(tid);
+    // create all the threads
+    for (i = 0; i < cnt; i++) {
+        struct exec_helper* eh = &ehs[i];
+
+        // init exec helper
+        eh->args = args_parse(cmdlines[i]);
+        sema_init(&eh->load, 0);
+        eh->parent = t;
+        eh->success = false;
+        if (!eh->args) {
+            tids[i] = TID_ERROR;
+            continue;
+        }
 
-    struct child_t* cp;
-    c->start = &cp;
+        /* Create a new thread to execute the command, named for its
+           first argument (thread_create truncates it). */
+        tids[i] = thread_create (eh->args->argc ? eh->args->strs : "",
+                                 PRI_DEFAULT, start_process, eh);
+    }
 
-    if (tid != TID_ERROR)
-    {  
-        // wait for child to load
-        sema_down(&eh.load);
-        if (eh.success) {
-            // succeeded! yay! add to our child list
-            list_push_back(&t->children, &cp->elem);
-            // also set child's parent to be us
-            eh.child->parent = t->tid;
-        } else {
-            // failed. boo. destroy tid
-            tid = TID_ERROR;
+    // then wait for each child to load
+    for (i = 0; i < cnt; i++) {
+        if (tids[i] != TID_ERROR) {
+            sema_down(&ehs[i].load);
+            if (ehs[i].success) started++;
+            else tids[i] = TID_ERROR;   // failed. boo. destroy tid
         }
+        free(ehs[i].args);
     }
 
-    free(eh.cmdline);
-
-    return tid;
+    free(ehs);
+    return started;
 }
 /* A thread function that loads a user process and starts it
    running. */
@@ -121,24 +244,33 @@ static void start_process (void *ehvp)
     if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
     if_.cs = SEL_UCSEG;
     if_.eflags = FLAG_IF | FLAG_MBS;
-    success = load (eh->cmdline, &if_.eip, &if_.esp);
+    success = load (eh->args, &if_.eip, &if_.esp);
 
     if (success) {
-        // setup dynamic child struct
-        t->cp = malloc(sizeof(struct child_t));
-        ASSERT(t->cp);
-        *t->start = t->cp;
-        // init cp
-        t->cp->pid  = t->tid;
-        t->cp->wait = false;
-        t->cp->exit = false;
-        sema_init(&t->cp->exit_sema, 0);
+        // setup dynamic child struct and become one of the parent's
+        // children.  the parent is blocked until we sema_up, so its
+        // lists can't change under us
+        struct child_t* cp = slab_alloc(&child_cache);
+        ASSERT(cp);
+        cp->pid    = t->tid;
+        cp->parent = eh->parent;
+        lock_acquire(&process_lock);
+        success = child_add(cp);
+        lock_release(&process_lock);
+        if (success) {
+            t->cp = cp;
+            t->parent = eh->parent->tid;
+        } else {
+            slab_free(&child_cache, cp);
+        }
+    }
+    if (success) {
+        // take over any redirected stdin/stdout while the parent waits
+        fds_inherit(eh->parent);
     }
 
     // did the load succeed?
     eh->success = success;
-    // what is the child process?
-    eh->child = t;
     // continue process_execute
     sema_up(&eh->load);
 
@@ -159,19 +291,6 @@ static void start_process (void *ehvp)
 }
 
 
-struct child_t* getChild(pid_t pid) {
-    struct list_elem* e;
-    struct child_t*     c;
-    struct thread*    t = thread_current();
-    for (e = list_begin(&t->children); e != list_end(&t->children); e = list_next(e)) {
-        c = list_entry(e, struct child_t, elem);
-        if (c->pid == pid)
-            return c;
-    }
-    return NULL;
-}
-
-
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -183,16 +302,41 @@ struct child_t* getChild(pid_t pid) {
    does nothing. */
 int process_wait (pid_t pid) 
 {
+    struct thread* t = thread_current();
+    int ret = -1;
+
+    lock_acquire(&process_lock);
     struct child_t* c = getChild(pid);
-    if (!c) return -1;
-    if (c->wait) return -1;
-    c->wait = true;
-
-    if (c->exit) return c->ret;
-    else {
-        sema_down(&c->exit_sema);
-        return c->ret;
+    if (c) {
+        while (!c->exit) cond_wait(&t->child_exit, &process_lock);
+        ret = child_reap(c);
     }
+    lock_release(&process_lock);
+    return ret;
+}
+
+/* Waits for any child process to die, stores its exit status into
+   *STATUS, and returns its pid.  A child that had already exited
+   is returned at once, in the order the children exited.  Each
+   child is returned only once, and not at all if process_wait()
+   was called for it.  Returns -1 immediately if there are no such
+   children. */
+pid_t process_wait_any (int* status)
+{
+    struct thread* t = thread_current();
+    pid_t pid = -1;
+
+    lock_acquire(&process_lock);
+    if (!list_empty(&t->children)) {
+        while (list_empty(&t->exited))
+            cond_wait(&t->child_exit, &process_lock);
+        struct child_t* c = list_entry(list_front(&t->exited),
+                                       struct child_t, exit_elem);
+        pid = c->pid;
+        *status = child_reap(c);
+    }
+    lock_release(&process_lock);
+    return pid;
 }
 
 
@@ -208,27 +352,36 @@ void process_exit (void) {
         nexte = list_next(e);
         struct fds* fdsp = list_entry(e, struct fds, elem);
         list_remove(&fdsp->elem);
-        file_close(fdsp->file_ptr);
-        free(fdsp);
+        fds_free(fdsp);
     }
 
-    // get rid of children pointers
+    lock_acquire(&process_lock);
+
+    // let go of our children.  any still running keep their child
+    // structs until they exit
     for(e = list_begin(&t->children); e != list_end(&t->children); e = nexte) {
         nexte = list_next(e);
         struct child_t* child = list_entry(e, struct child_t, elem);
         list_remove(&child->elem);
-        if (!child->exit) thread_get(child->pid)->cp = NULL;
-        free(child);
+        ohash_delete(&child_map, child->pid);
+        child->parent = NULL;
+        child_release(child);
     }
 
-    if (t->cp) { // if parent hasn't exited, basically
+    // tell our parent, if it's still around, that we've exited
+    if (t->cp) {
+        struct thread* parent = t->cp->parent;
         t->cp->exit = true;
-        // if being waited on, signal
-        if (t->cp->wait) {
-            sema_up(&t->cp->exit_sema);
+        if (parent) {
+            list_push_back(&parent->exited, &t->cp->exit_elem);
+            cond_broadcast(&parent->child_exit, &process_lock);
         }
+        child_release(t->cp);
+        t->cp = NULL;
     }
 
+    lock_release(&process_lock);
+
     /* Destroy the current process's page directory and switch back
        to the kernel-only page directory. */
     pd = t->pagedir;
@@ -254,8 +407,14 @@ void process_activate (void)
 {
     struct thread *t = thread_current ();
 
-    /* Activate thread's page tables. */
-    pagedir_activate(t->pagedir);
+    /* Activate thread's page tables.  A kernel thread has none of
+       its own and touches only kernel memory, which is mapped the
+       same in every page directory, so it just keeps running in
+       whichever one was already active.  That saves reloading CR3,
+       and flushing the TLB, on every switch to and from the idle
+       thread or another kernel thread. */
+    if (t->pagedir != NULL)
+        pagedir_activate(t->pagedir);
 
     /* Set thread's kernel stack for use in processing
        interrupts. */
@@ -325,24 +484,48 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp, const char*);
-void setupMainArgs(void** sp, const char* cmdline);
+/* Most loadable segments an executable may have. */
+#define IMAGE_SEG_MAX 16
+
+/* A loadable segment, in the form load_segment() takes. */
+struct image_seg
+{
+    uint32_t file_page;         /* Page-aligned offset in the file. */
+    uint32_t mem_page;          /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Writable by the user process? */
+};
+
+/* An executable's validated ELF header and segment table: all
+   load() needs to know besides the segments' contents. */
+struct image
+{
+    void (*entry) (void);       /* Entry point. */
+    int seg_cnt;                /* Number of loadable segments. */
+    struct image_seg segs[IMAGE_SEG_MAX];
+};
+
+static bool setup_stack (void **esp, const struct args *);
+void setupMainArgs(void** sp, const struct args* args);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
         uint32_t read_bytes, uint32_t zero_bytes,
         bool writable);
+static bool image_lookup (struct file *, struct image *);
+static void image_store (struct file *, const struct image *);
+static bool image_parse (struct file *, struct image *, const char *name);
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 
-bool load (const char* cmdline, void (**eip) (void), void **esp) //##Change file name to cmd_line
+bool load (const struct args* args, void (**eip) (void), void **esp)
 {
     struct thread *t = thread_current();
-    struct Elf32_Ehdr ehdr;
+    struct image image;
     struct file *file = NULL;
-    off_t file_ofs;
     bool success = false;
     int i;
 
@@ -364,7 +547,55 @@ bool load (const char* cmdline, void (**eip) (void), void **esp) //##Change file
     file_deny_write(file);
     t->program = file;
 
+    /* Find out where the segments go, from the image cache if this
+       executable has been loaded before and not written since. */
+    if (!image_lookup (file, &image))
+    {
+        if (!image_parse (file, &image, t->name))
+            goto done;
+        image_store (file, &image);
+    }
+
+    /* Load segments. */
+    for (i = 0; i < image.seg_cnt; i++)
+    {
+        const struct image_seg *seg = &image.segs[i];
+        if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                    seg->read_bytes, seg->zero_bytes, seg->writable))
+            goto done;
+    }
+
+    /* Set up stack. */
+    if (!setup_stack(esp, args))
+        goto done;
+
+    /* Start address. */
+    *eip = image.entry;
+
+    success = true;
+
+done:
+    /* We arrive here whether the load is successful or not. */
+    if (!success) file_close (file);
+    return success;
+}
+
+/* load() helpers. */
+
+/* Reads and verifies FILE's executable header and program
+   headers, and stores its entry point and loadable segments into
+   *IMAGE.  NAME is the program's name, for error messages.
+   Returns true if successful, false if FILE is not a valid
+   executable. */
+static bool image_parse (struct file *file, struct image *image,
+        const char *name)
+{
+    struct Elf32_Ehdr ehdr;
+    off_t file_ofs;
+    int i;
+
     /* Read and verify executable header. */
+    file_seek (file, 0);
     if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
             || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
             || ehdr.e_type != 2
@@ -373,9 +604,11 @@ bool load (const char* cmdline, void (**eip) (void), void **esp) //##Change file
             || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
             || ehdr.e_phnum > 1024) 
     {
-        printf ("load: %s: error loading executable\n", t->name);
-        goto done; 
+        printf ("load: %s: error loading executable\n", name);
+        return false;
     }
+    image->entry = (void (*) (void)) ehdr.e_entry;
+    image->seg_cnt = 0;
 
     /* Read program headers. */
     file_ofs = ehdr.e_phoff;
@@ -384,11 +617,11 @@ bool load (const char* cmdline, void (**eip) (void), void **esp) //##Change file
         struct Elf32_Phdr phdr;
 
         if (file_ofs < 0 || file_ofs > file_length (file))
-            goto done;
+            return false;
         file_seek (file, file_ofs);
 
         if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-            goto done;
+            return false;
         file_ofs += sizeof phdr;
         switch (phdr.p_type) 
         {
@@ -402,56 +635,176 @@ bool load (const char* cmdline, void (**eip) (void), void **esp) //##Change file
             case PT_DYNAMIC:
             case PT_INTERP:
             case PT_SHLIB:
-                goto done;
+                return false;
             case PT_LOAD:
-                if (validate_segment (&phdr, file)) 
+                if (validate_segment (&phdr, file)
+                        && image->seg_cnt < IMAGE_SEG_MAX) 
                 {
-                    bool writable = (phdr.p_flags & PF_W) != 0;
-                    uint32_t file_page = phdr.p_offset & ~PGMASK;
-                    uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+                    struct image_seg *seg = &image->segs[image->seg_cnt++];
                     uint32_t page_offset = phdr.p_vaddr & PGMASK;
-                    uint32_t read_bytes, zero_bytes;
+                    seg->writable = (phdr.p_flags & PF_W) != 0;
+                    seg->file_page = phdr.p_offset & ~PGMASK;
+                    seg->mem_page = phdr.p_vaddr & ~PGMASK;
                     if (phdr.p_filesz > 0)
                     {
                         /* Normal segment.
                            Read initial part from disk and zero the rest. */
-                        read_bytes = page_offset + phdr.p_filesz;
-                        zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                        seg->read_bytes = page_offset + phdr.p_filesz;
+                        seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                                - seg->read_bytes);
                     }
                     else 
                     {
                         /* Entirely zero.
                            Don't read anything from disk. */
-                        read_bytes = 0;
-                        zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                        seg->read_bytes = 0;
+                        seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                     }
-                    if (!load_segment (file, file_page, (void *) mem_page,
-                                read_bytes, zero_bytes, writable))
-                        goto done;
                 }
                 else
-                    goto done;
+                    return false;
                 break;
         }
     }
+    return true;
+}
 
-    /* Set up stack. */
-    if (!setup_stack(esp, cmdline))
-        goto done;
+/* Executable image cache.
 
-    /* Start address. */
-    *eip = (void (*) (void)) ehdr.e_entry;
+   Parsing an executable's headers takes a read of the ELF header
+   and a seek and read for every program header, all repeated each
+   time the same program is run.  The cache keeps the parsed and
+   validated result for the most recently loaded executables.
 
-    success = true;
+   Each entry keeps its inode open, so that the inode's version
+   number, which changes on every write to it, stays meaningful;
+   an entry whose inode has been written since it was parsed is
+   stale and is parsed again.  An entry whose inode has been
+   removed is dropped by process_forget_removed(), which the
+   remove system call invokes, or else when next looked at, so
+   that the inode's sectors are freed.  process_done() drops
+   every entry before the file system shuts down. */
 
-done:
-    /* We arrive here whether the load is successful or not. */
-    if (!success) file_close (file);
-    return success;
+/* Number of executables cached. */
+#define IMAGE_CACHE_CNT 8
+
+struct image_entry
+{
+    struct inode *inode;        /* Executable, or NULL if unused. */
+    unsigned version;           /* INODE's version when parsed. */
+    unsigned last_use;          /* IMAGE_CLOCK when last used. */
+    struct image image;         /* Parsed headers. */
+};
+
+static struct image_entry image_cache[IMAGE_CACHE_CNT];
+static unsigned image_clock;    /* Counts lookups, for LRU. */
+static struct lock image_lock;  /* Protects the cache. */
+
+/* Initializes the image cache. */
+static void image_init (void)
+{
+    lock_init (&image_lock);
 }
 
-/* load() helpers. */
+/* Drops entry E from the image cache.
+   IMAGE_LOCK must be held. */
+static void image_evict (struct image_entry *e)
+{
+    inode_close (e->inode);
+    e->inode = NULL;
+}
+
+/* Drops every entry from the image cache whose inode has been
+   removed, or every entry at all if ALL is true. */
+static void image_flush (bool all)
+{
+    int i;
+
+    lock_acquire (&image_lock);
+    for (i = 0; i < IMAGE_CACHE_CNT; i++)
+    {
+        struct image_entry *e = &image_cache[i];
+        if (e->inode != NULL && (all || inode_is_removed (e->inode)))
+            image_evict (e);
+    }
+    lock_release (&image_lock);
+}
+
+/* Closes the executables held open by the image cache that have
+   been removed, so that their sectors are freed now rather than
+   at the next exec. */
+void process_forget_removed (void)
+{
+    image_flush (false);
+}
+
+/* Closes every executable held open by the image cache.  Must be
+   called before the file system shuts down. */
+void process_done (void)
+{
+    image_flush (true);
+}
+
+/* Looks up FILE's executable in the image cache.  If it is there
+   and has not been written since it was parsed, copies its image
+   into *IMAGE and returns true.  Otherwise returns false. */
+static bool image_lookup (struct file *file, struct image *image)
+{
+    struct inode *inode = file_get_inode (file);
+    bool found = false;
+    int i;
+
+    lock_acquire (&image_lock);
+    image_clock++;
+    for (i = 0; i < IMAGE_CACHE_CNT; i++)
+    {
+        struct image_entry *e = &image_cache[i];
+        if (e->inode == NULL)
+            continue;
+        if (inode_is_removed (e->inode))
+            image_evict (e);
+        else if (e->inode == inode && e->version == inode_version (inode))
+        {
+            *image = e->image;
+            e->last_use = image_clock;
+            found = true;
+        }
+    }
+    lock_release (&image_lock);
+    return found;
+}
+
+/* Adds IMAGE, just parsed from FILE, to the image cache,
+   replacing any stale entry for FILE's inode or else the least
+   recently used entry. */
+static void image_store (struct file *file, const struct image *image)
+{
+    struct inode *inode = file_get_inode (file);
+    struct image_entry *victim = NULL;
+    int i;
+
+    lock_acquire (&image_lock);
+    for (i = 0; i < IMAGE_CACHE_CNT && victim == NULL; i++)
+        if (image_cache[i].inode == inode)
+            victim = &image_cache[i];
+    for (i = 0; i < IMAGE_CACHE_CNT && victim == NULL; i++)
+        if (image_cache[i].inode == NULL)
+            victim = &image_cache[i];
+    if (victim == NULL)
+    {
+        victim = &image_cache[0];
+        for (i = 1; i < IMAGE_CACHE_CNT; i++)
+            if (image_cache[i].last_use < victim->last_use)
+                victim = &image_cache[i];
+    }
+    if (victim->inode != NULL)
+        image_evict (victim);
+    victim->inode = inode_reopen (inode);
+    victim->version = inode_version (inode);
+    victim->last_use = image_clock;
+    victim->image = *image;
+    lock_release (&image_lock);
+}
 
 static bool install_page (void *upage, void *kpage, bool writable);
 
@@ -558,102 +911,28 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 }
 
 
-void __push(void** sp, const void* data, unsigned size) {
-    int i;
-    uint8_t* dst = *sp;
-    uint8_t* src = data;
-    for(i = 0; i < size; ++i)
-        dst[-(i+1)] = src[size-(i+1)];
-    *sp = (void*)(dst - size);
-}
-
-#define WORDS 0
-#define SPACE 1
-
-void setupMainArgs(void** sp, const char* cmdline) {
-    void* spOrig = *sp;
-    char* sptmpi;
-    char* sptmpj;
-    char* argv0;
-    int   argc = 0;
-
+// lays args out at the top of the user stack, just below *sp, the way
+// main expects them, and moves *sp down past them.  the strings go in
+// with one copy and each argv[] entry is written straight to its final
+// place, so nothing is pushed and moved again
+void setupMainArgs(void** sp, const struct args* args) {
+    void*  top  = *sp;
+    char*  strs = (char*)*sp - args->size;
+    char** argv = (char**)ROUND_DOWN((uintptr_t)strs, sizeof(void*))
+                  - (args->argc + 1);
     int i;
-    int sz = strlen(cmdline);
-
-    // copy the data in
-    __push(sp, cmdline, sz+1);
-    // hexdump(*sp - 16, 64);
-
-    sptmpi = spOrig;
-    sptmpj = spOrig-2;
-    // start in space or letter mode
-    int mode = SPACE;
-    while (sptmpj >= *sp) {
-        switch(mode) {
-            case WORDS: // letters
-                if (isspace(*sptmpj)) {
-                    mode = SPACE;
-                } else {
-                    *--sptmpi = *sptmpj;
-                }
-                break;
-
-            case SPACE: // whitespace
-                if (!isspace(*sptmpj)) {
-                    *--sptmpi = '\0';
-                    *--sptmpi = *sptmpj;
-                    mode = WORDS;
-                }
-                break;
-        }
-        sptmpj--;
-    }
-    // hexdump(*sp - 16, 64);
-
-    // store the address of argv[0] and change the sp location
-    *sp = argv0 = sptmpi;
-
-    i = 0;
-    // printf("word aligning by %d...\n", (unsigned)*sp % 4);
-    if ((unsigned)*sp % 4) {
-        // word-align sp
-        __push(sp, &i, (unsigned)*sp % 4);
-    }
-
-    sptmpi = 0;
-    __push(sp, &sptmpi, sizeof(char*));
-
-    sptmpi = spOrig-1;
-    while (sptmpi > argv0) {
-        // so triggered rn
-        if (*sptmpi == '\0') {
-            // if not first one (the null of last term)
-            if (argc) {
-                sptmpi++;
-                __push(sp, &sptmpi, sizeof(char*));
-                sptmpi--;
-            }
-            // increment where we find the data
-            argc++;
-            // hexdump(*sp, 64);
-        }
-        // increment where we're looking
-        sptmpi--;
-    }
-    // hexdump(*sp - 16, 64);
-    // push argv[0]
-    __push(sp, &argv0, sizeof(char*));
-
-    // push argv
-    sptmpi = *sp;
-    __push(sp, &sptmpi, sizeof(char**));
-
-    // push argc
-    __push(sp, &argc, sizeof(int));
 
-    sptmpi = NULL;
-    // push return address
-    __push(sp, &sptmpi, sizeof(void*));
+    memcpy(strs, args->strs, args->size);
+    for (i = 0; i < args->argc; i++)
+        argv[i] = strs + args->ofs[i];
+    argv[args->argc] = NULL;
+
+    // argv, argc, then the return address
+    argv[-1] = (char*)argv;
+    argv[-2] = (char*)args->argc;
+    argv[-3] = NULL;
+    *sp = argv - 3;
+    ASSERT((uint8_t*)*sp + args_frame_size(args) == (uint8_t*)top);
 }
 
 #ifndef HEXDUMP_COLS
@@ -711,31 +990,32 @@ void hexdump(void *mem, unsigned int len)
 
 
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
-static bool setup_stack(void** esp, const char* cmdline)
+/* Create a minimal stack by mapping zeroed pages at the top of
+   user virtual memory: enough to hold ARGS, plus one page for the
+   program to run in, then lay ARGS out on it. */
+static bool setup_stack(void** esp, const struct args* args)
 {
-    uint8_t* kpage;
-    bool success = false;
+    size_t page_cnt = DIV_ROUND_UP(args_frame_size(args), PGSIZE) + 1;
+    uint8_t* upage = PHYS_BASE;
+    size_t i;
 
-    kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-    if (kpage != NULL)
+    for (i = 0; i < page_cnt; i++)
     {
-        success = install_page(((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-        if (success)
-            *esp = PHYS_BASE; // 0xc0000000
-        else
+        uint8_t* kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+        upage -= PGSIZE;
+        if (kpage == NULL)
+            return false;
+        // pages already installed are freed with the page directory
+        if (!install_page(upage, kpage, true))
+        {
             palloc_free_page (kpage);
+            return false;
+        }
     }
 
-    setupMainArgs(esp, cmdline);
-
-    // printf("\n");
-    // hexdump(*esp - 16, 128);
-
-    // hexdump(esp, 4);
-
-    return success;
+    *esp = PHYS_BASE; // 0xc0000000
+    setupMainArgs(esp, args);
+    return true;
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
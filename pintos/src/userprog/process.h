@@ -3,13 +3,22 @@
 
 #include "threads/thread.h"
 
+/* -al: Most pages of stack a process's arguments may take up. */
+extern size_t process_arg_pages;
+
+/* Most programs one process_execute_many() call may start. */
+#define PROCESS_SPAWN_MAX 64
+
+void process_init (void);
+void process_done (void);
+void process_forget_removed (void);
 tid_t process_execute (const char *file_name);
+int process_execute_many (const char **cmdlines, int cnt, tid_t *tids);
 
 int process_wait (pid_t);
+pid_t process_wait_any (int *status);
 void process_exit (void);
 void process_activate (void);
 
-struct child_t* getChild(pid_t pid);
-
 
 #endif /* userprog/process.h */
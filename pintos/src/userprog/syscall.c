@@ -1,12 +1,15 @@
 #include "userprog/syscall.h"
+#include <limits.h>
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <uio.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
 #include "userprog/process.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/file.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
@@ -18,12 +21,70 @@ bool validate_buffer(const void* uaddr, off_t size);
 bool validate_string(const char* uaddr);
 uint32_t getArg(void**);
 struct file* getFileP(int);
+static struct fds* getFds(struct thread*, int);
+static struct pipe* getPipe(int, bool);
 
 struct lock file_lock;
 
+// cache of file descriptor entries
+static struct slab_cache fds_cache;
+
 void syscall_init (void) {
     intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
     lock_init (&file_lock);
+    slab_cache_init(&fds_cache, "fds", sizeof(struct fds), 0, NULL);
+}
+
+// adds fd to t's open files, referring to file f, or if p isn't NULL,
+// to p's write end if write is true and its read end otherwise
+static void fds_add(struct thread* t, int fd, struct file* f,
+                    struct pipe* p, bool write) {
+    struct fds* fdsp = slab_alloc(&fds_cache);
+    ASSERT(fdsp);
+    fdsp->file_desc  = fd;
+    fdsp->file_ptr   = f;
+    fdsp->pipe       = p;
+    fdsp->pipe_write = write;
+    list_push_back(&t->files, &fdsp->elem);
+}
+
+// adds fd to the current thread's open files, referring to what src
+// refers to.  a file is reopened at the same position, so the two
+// don't share a position afterward.  returns false if the file can't
+// be reopened.  call with file_lock held
+static bool fds_dup(struct fds* src, int fd) {
+    struct file* f = NULL;
+    if (src->pipe) {
+        pipe_open(src->pipe, src->pipe_write);
+    } else {
+        f = file_reopen(src->file_ptr);
+        if (!f) return false;
+        file_seek(f, file_tell(src->file_ptr));
+    }
+    fds_add(thread_current(), fd, f, src->pipe, src->pipe_write);
+    return true;
+}
+
+// closes the file or pipe end a file descriptor entry refers to and
+// returns the entry to the fds cache
+void fds_free(struct fds* fdsp) {
+    if (fdsp->pipe) pipe_close(fdsp->pipe, fdsp->pipe_write);
+    else file_close(fdsp->file_ptr);
+    slab_free(&fds_cache, fdsp);
+}
+
+// gives a newly loaded process copies of its parent's standard input
+// and output (fds 0 and 1), if the parent has redirected them, so
+// that a shell can connect processes with pipes.  the parent must be
+// blocked in exec() so that its fds don't change under us
+void fds_inherit(struct thread* parent) {
+    int fd;
+    lock_acquire(&file_lock);
+    for (fd = 0; fd <= 1; fd++) {
+        struct fds* fdsp = getFds(parent, fd);
+        if (fdsp) fds_dup(fdsp, fd);
+    }
+    lock_release(&file_lock);
 }
 
 uint32_t getArg(void** vp) {
@@ -126,6 +187,66 @@ static void syscall_handler (struct intr_frame *f UNUSED)
             x      = (int)      getArg(&f->esp); // file descriptor
             close(x);
             break;
+        case SYS_FSYNC:
+            x      = (int)      getArg(&f->esp); // file descriptor
+            f->eax = (uint32_t) fsync(x);        // success (int)
+            break;
+        case SYS_SYNC:
+            sync();
+            break;
+        case SYS_PREAD:
+            if (!validate_buffer(fesp, 20)) exit(-1); // 4 arguments
+            x      = (int)      getArg(&f->esp); // file descriptor
+            vp     = (void*)    getArg(&f->esp); // buffer
+            y      = (int)      getArg(&f->esp); // size
+            u      = (unsigned) getArg(&f->esp); // position
+            f->eax = (uint32_t) pread(x, vp, y, u); // numBytes read (int)
+            break;
+        case SYS_PWRITE:
+            if (!validate_buffer(fesp, 20)) exit(-1); // 4 arguments
+            x      = (int)      getArg(&f->esp); // file descriptor
+            vp     = (void*)    getArg(&f->esp); // buffer
+            y      = (int)      getArg(&f->esp); // size
+            u      = (unsigned) getArg(&f->esp); // position
+            f->eax = (uint32_t) pwrite(x, vp, y, u); // numBytes written (int)
+            break;
+        case SYS_READV:
+            x      = (int)      getArg(&f->esp); // file descriptor
+            vp     = (void*)    getArg(&f->esp); // iovec array
+            y      = (int)      getArg(&f->esp); // iovec count
+            f->eax = (uint32_t) readv(x, vp, y); // numBytes read (int)
+            break;
+        case SYS_WRITEV:
+            x      = (int)      getArg(&f->esp); // file descriptor
+            vp     = (void*)    getArg(&f->esp); // iovec array
+            y      = (int)      getArg(&f->esp); // iovec count
+            f->eax = (uint32_t) writev(x, vp, y); // numBytes written (int)
+            break;
+        case SYS_COPY_FILE_RANGE:
+            x      = (int)      getArg(&f->esp); // input file descriptor
+            y      = (int)      getArg(&f->esp); // output file descriptor
+            u      = (unsigned) getArg(&f->esp); // size
+            f->eax = (uint32_t) copy_file_range(x, y, u); // numBytes copied
+            break;
+        case SYS_PIPE:
+            vp     = (void*)    getArg(&f->esp); // array of 2 fds
+            f->eax = (uint32_t) pipe(vp);        // success (int)
+            break;
+        case SYS_DUP2:
+            x      = (int)      getArg(&f->esp); // old file descriptor
+            y      = (int)      getArg(&f->esp); // new file descriptor
+            f->eax = (uint32_t) dup2(x, y);      // new fd (int)
+            break;
+        case SYS_WAIT_ANY:
+            vp     = (void*)    getArg(&f->esp); // exit status
+            f->eax = (uint32_t) wait_any(vp);    // child (pid_t)
+            break;
+        case SYS_SPAWN_MANY:
+            vp     = (void*)    getArg(&f->esp); // command lines
+            x      = (int)      getArg(&f->esp); // number of commands
+            cp     = (char*)    getArg(&f->esp); // pids (pid_t array)
+            f->eax = (uint32_t) spawn_many(vp, x, (pid_t*) cp); // # started
+            break;
         default:
             printf ("system call [%d] not implemented!\n", f->vec_no);
     }
@@ -170,6 +291,33 @@ int wait (pid_t pid) {
     return process_wait(pid);
 }
 
+// like exec, but runs each of the cnt command lines in cmdlines and
+// stores the new process's pid, or -1, into the matching element of
+// pids.  the children all load at the same time, so this returns
+// when the slowest has loaded instead of after each in turn
+// returns the number of children started, or -1 if cnt is negative or
+// above PROCESS_SPAWN_MAX, which also keeps the sizes below from
+// overflowing
+int spawn_many (const char** cmdlines, int cnt, pid_t* pids) {
+    int i;
+    if (cnt < 0 || cnt > PROCESS_SPAWN_MAX) return -1;
+    if (!validate_buffer(cmdlines, cnt * sizeof *cmdlines)) exit(-1);
+    if (!validate_buffer(pids, cnt * sizeof *pids)) exit(-1);
+    for (i = 0; i < cnt; i++)
+        if (!validate_string(cmdlines[i])) exit(-1);
+    return process_execute_many(cmdlines, cnt, pids);
+}
+
+// wait for whichever child process exits first, and retrieve its pid
+// and, unless status is NULL, its exit status
+pid_t wait_any (int* status) {
+    int ret;
+    if (status && !validate_buffer(status, sizeof *status)) exit(-1);
+    pid_t pid = process_wait_any(&ret);
+    if (pid != -1 && status) *status = ret;
+    return pid;
+}
+
 // create a new file with an initial size
 // return whether or not successful
 bool create (const char *file, unsigned initial_size) {
@@ -186,6 +334,8 @@ bool remove (const char *file) {
     if (!validate_string(file)) exit(-1);
     lock_acquire(&file_lock);
     bool ret = filesys_remove(file);
+    // a cached executable keeps the file open, so let it go
+    if (ret) process_forget_removed();
     lock_release(&file_lock);
     return ret;
 }
@@ -195,33 +345,42 @@ int open (const char *file) {
     if (!validate_string(file)) exit(-1);
     lock_acquire(&file_lock);
     int file_desc = thread_current()->fd++; //file_desc takes and curr file desc
-    struct fds* fdsp;                       // and increments
+                                            // and increments
     struct file* f = filesys_open(file);
     if (!f) {
         lock_release(&file_lock);
         return -1;
     }
-    fdsp = (struct fds*)malloc(sizeof(fdsp));
-    ASSERT(fdsp);
-    fdsp->file_desc = file_desc;
-    fdsp->file_ptr  = f;
-    list_push_back(&thread_current()->files, &fdsp->elem);
+    fds_add(thread_current(), file_desc, f, NULL, false);
     lock_release(&file_lock);
     return file_desc;
 }
 
 
-struct file* getFileP(int fd) {
-    struct fds*  fdsp = NULL;
-    struct thread* t = thread_current();
+// returns t's entry for fd, or NULL if fd isn't open
+static struct fds* getFds(struct thread* t, int fd) {
     struct list_elem* e = NULL;
     for(e = list_begin(&t->files); e != list_end(&t->files); e = list_next(e)) {
-        fdsp = list_entry(e, struct fds, elem);
-        if (fdsp->file_desc == fd) return fdsp->file_ptr;
+        struct fds* fdsp = list_entry(e, struct fds, elem);
+        if (fdsp->file_desc == fd) return fdsp;
     }
     return NULL;
 }
 
+// returns the file fd refers to, or NULL if fd isn't an open file
+struct file* getFileP(int fd) {
+    struct fds* fdsp = getFds(thread_current(), fd);
+    return fdsp ? fdsp->file_ptr : NULL;
+}
+
+// returns the pipe fd refers to, if fd is its write end and write is
+// true or its read end and write is false, and otherwise NULL.
+// file_lock isn't needed, because only this thread uses its fds
+static struct pipe* getPipe(int fd, bool write) {
+    struct fds* fdsp = getFds(thread_current(), fd);
+    return fdsp && fdsp->pipe_write == write ? fdsp->pipe : NULL;
+}
+
 // returns the size in bytes of the file specified by the fd
 int filesize (int fd) {
     lock_acquire(&file_lock);
@@ -237,18 +396,17 @@ int filesize (int fd) {
 
 // read size bytes from the fd open into buffer
 // returns number of bytes actually read
-// fd 0 reads from the keyboard using input_getc()
+// fd 0 reads from the keyboard using input_read(), unless it has
+//    been redirected.  like a terminal, it returns at the end of a
+//    line or once the keys typed so far are used up, waiting only if
+//    none have been typed yet
+// a pipe's read end blocks until there's data or no writers are left
 int read (int fd, void *buffer, unsigned size) {
     if (!validate_buffer(buffer, size)) exit(-1);
-    if (fd == 0)
-    {
-        //write read from keyboard
-        unsigned i;
-        for(i = 0; i < size; i++)
-        {
-            ((char*)buffer)[i] = input_getc();
-        }
-    }
+    struct pipe* p = getPipe(fd, false);
+    if (p) return pipe_read(p, buffer, size);
+    if (fd == 0 && !getFds(thread_current(), 0))
+        return input_read(buffer, size, true);
     lock_acquire(&file_lock);
     struct file* f = getFileP(fd);
     if (!f) {
@@ -263,10 +421,14 @@ int read (int fd, void *buffer, unsigned size) {
 // write size bytes from buffer to the open file fd.
 // returns number of bytes actually written
 // fd 1 writes to the console using one call to putbuf() as long as size isn't
-//    longer than a few hundred bytes (weird stuff happens)
+//    longer than a few hundred bytes (weird stuff happens), unless it
+//    has been redirected
+// a pipe's write end blocks while the pipe is full
 int write (int fd, const void *buffer, unsigned size) {
     if (!validate_buffer(buffer, size)) exit(-1);
-    if(fd == 1) {
+    struct pipe* p = getPipe(fd, true);
+    if (p) return pipe_write(p, buffer, size);
+    if(fd == 1 && !getFds(thread_current(), 1)) {
         //write  to console
         putbuf(buffer, size);
         return size;
@@ -310,6 +472,7 @@ unsigned tell (int fd) {
 
 // close file descriptor fd.
 // make sure to close all fds when a process ends
+// closing a redirected fd 0 or 1 goes back to the keyboard or console
 void close (int fd) {
     lock_acquire(&file_lock);
     struct thread* t = thread_current();
@@ -320,8 +483,7 @@ void close (int fd) {
         if(fdsp->file_desc == fd)
         {
             list_remove(&fdsp->elem);
-            file_close(fdsp->file_ptr);
-            free(fdsp);
+            fds_free(fdsp);
             lock_release(&file_lock);
             return;
         }
@@ -329,5 +491,227 @@ void close (int fd) {
     lock_release(&file_lock);
 }
 
+// write the changes made to file descriptor fd so far to disk
+// returns 0 on success, -1 if fd is not open
+// file_lock is dropped before flushing, so that other processes
+// can keep using the file system, and so that fsyncs from several
+// processes wait on the same log commit instead of queueing up
+// behind each other.  the file can't be closed under us because
+// only this thread uses its fds.
+int fsync (int fd) {
+    lock_acquire(&file_lock);
+    struct file* f = getFileP(fd);
+    lock_release(&file_lock);
+    if (!f) return -1;
+    file_sync(f);
+    return 0;
+}
 
+// write every change to the file system so far to disk
+void sync (void) {
+    filesys_sync();
+}
 
+// read size bytes from the file open as fd, starting at position,
+// into buffer.  doesn't use or change fd's current position.
+// returns number of bytes actually read, or -1 if fd isn't an open
+// file or position is past what an off_t can hold
+int pread (int fd, void *buffer, unsigned size, unsigned position) {
+    if (!validate_buffer(buffer, size)) exit(-1);
+    if ((off_t) position < 0) return -1;
+    lock_acquire(&file_lock);
+    struct file* f = getFileP(fd);
+    if (!f) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    int ret = file_read_at(f, buffer, size, position);
+    lock_release(&file_lock);
+    return ret;
+}
+
+// write size bytes from buffer to the file open as fd, starting at
+// position.  doesn't use or change fd's current position.
+// returns number of bytes actually written, or -1 if fd isn't an
+// open file or position is past what an off_t can hold
+int pwrite (int fd, const void *buffer, unsigned size, unsigned position) {
+    if (!validate_buffer(buffer, size)) exit(-1);
+    if ((off_t) position < 0) return -1;
+    lock_acquire(&file_lock);
+    struct file* f = getFileP(fd);
+    if (!f) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    int ret = file_write_at(f, buffer, size, position);
+    lock_release(&file_lock);
+    return ret;
+}
+
+// checks that iov holds iovcnt readable iovecs whose buffers are all
+// valid, killing the process if not.  returns false if iovcnt is out
+// of range or the buffers add up to more bytes than an int can count
+static bool validate_iovec(const struct iovec* iov, int iovcnt) {
+    unsigned total = 0;
+    int i;
+    if (iovcnt < 0 || iovcnt > IOV_MAX) return false;
+    if (!validate_buffer(iov, iovcnt * sizeof *iov)) exit(-1);
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > INT_MAX - total) return false;
+        total += iov[i].iov_len;
+        if (!validate_buffer(iov[i].iov_base, iov[i].iov_len)) exit(-1);
+    }
+    return true;
+}
+
+// like read(), but fills the iovcnt buffers in iov one after another,
+// all in one system call.  stops at the first short read.
+// returns total number of bytes read, or -1 if fd isn't open or
+// iovcnt isn't between 0 and IOV_MAX
+int readv (int fd, const struct iovec* iov, int iovcnt) {
+    int total = 0;
+    int i;
+    if (!validate_iovec(iov, iovcnt)) return -1;
+    struct pipe* p = getPipe(fd, false);
+    if (p) {
+        for (i = 0; i < iovcnt; i++) {
+            int n = pipe_read(p, iov[i].iov_base, iov[i].iov_len);
+            total += n;
+            if ((size_t) n < iov[i].iov_len) break;
+        }
+        return total;
+    }
+    if (fd == 0 && !getFds(thread_current(), 0)) {
+        // read from keyboard, a line at most, like read().  only
+        // wait while nothing has been read, so a full iovec doesn't
+        // make the next one block for more keys
+        for (i = 0; i < iovcnt; i++) {
+            char* cp = iov[i].iov_base;
+            size_t n = input_read(iov[i].iov_base, iov[i].iov_len,
+                                  total == 0);
+            total += n;
+            if (n < iov[i].iov_len) break;
+            if (n > 0 && (cp[n - 1] == '\r' || cp[n - 1] == '\n')) break;
+        }
+        return total;
+    }
+    lock_acquire(&file_lock);
+    struct file* f = getFileP(fd);
+    if (!f) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        int n = file_read(f, iov[i].iov_base, iov[i].iov_len);
+        total += n;
+        if ((size_t) n < iov[i].iov_len) break;
+    }
+    lock_release(&file_lock);
+    return total;
+}
+
+// like write(), but writes the iovcnt buffers in iov one after
+// another, all in one system call.  stops at the first short write.
+// returns total number of bytes written, or -1 if fd isn't open or
+// iovcnt isn't between 0 and IOV_MAX
+int writev (int fd, const struct iovec* iov, int iovcnt) {
+    int total = 0;
+    int i;
+    if (!validate_iovec(iov, iovcnt)) return -1;
+    struct pipe* p = getPipe(fd, true);
+    if (p) {
+        for (i = 0; i < iovcnt; i++) {
+            int n = pipe_write(p, iov[i].iov_base, iov[i].iov_len);
+            if (n < 0) return total ? total : -1;
+            total += n;
+            if ((size_t) n < iov[i].iov_len) break;
+        }
+        return total;
+    }
+    if (fd == 1 && !getFds(thread_current(), 1)) {
+        // write to console
+        for (i = 0; i < iovcnt; i++) {
+            putbuf(iov[i].iov_base, iov[i].iov_len);
+            total += iov[i].iov_len;
+        }
+        return total;
+    }
+    lock_acquire(&file_lock);
+    struct file* f = getFileP(fd);
+    if (!f) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        int n = file_write(f, iov[i].iov_base, iov[i].iov_len);
+        total += n;
+        if ((size_t) n < iov[i].iov_len) break;
+    }
+    lock_release(&file_lock);
+    return total;
+}
+
+// copy up to size bytes from the file open as in_fd, starting at its
+// current position, to the file open as out_fd at its current
+// position, advancing both.  the data never passes through user
+// memory, so there's no buffer to validate.
+// returns number of bytes actually copied, or -1 if either fd isn't
+// an open file
+int copy_file_range (int in_fd, int out_fd, unsigned size) {
+    if (size > INT_MAX) size = INT_MAX;
+    lock_acquire(&file_lock);
+    struct file* in = getFileP(in_fd);
+    struct file* out = getFileP(out_fd);
+    if (!in || !out) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    int ret = file_copy(out, in, size);
+    lock_release(&file_lock);
+    return ret;
+}
+
+// create a pipe, storing a new fd for its read end into pfd[0] and one
+// for its write end into pfd[1]
+// returns 0 on success, -1 if out of memory
+int pipe (int* pfd) {
+    if (!validate_buffer(pfd, 2 * sizeof *pfd)) exit(-1);
+    struct pipe* p = pipe_create();
+    if (!p) return -1;
+    struct thread* t = thread_current();
+    pfd[0] = t->fd++;
+    fds_add(t, pfd[0], NULL, p, false);
+    pfd[1] = t->fd++;
+    fds_add(t, pfd[1], NULL, p, true);
+    return 0;
+}
+
+// make newfd refer to the same file or pipe end as oldfd, closing
+// newfd first if it's open.  a file is reopened at oldfd's position
+// instead of sharing one position with it.  dup2(fd, 0) and
+// dup2(fd, 1) redirect standard input and output, which exec()
+// passes on to the child
+// returns newfd, or -1 if oldfd isn't open or newfd is negative
+int dup2 (int oldfd, int newfd) {
+    struct thread* t = thread_current();
+    lock_acquire(&file_lock);
+    struct fds* old = getFds(t, oldfd);
+    if (!old || newfd < 0) {
+        lock_release(&file_lock);
+        return -1;
+    }
+    if (oldfd != newfd) {
+        struct fds* cur = getFds(t, newfd);
+        if (cur) {
+            list_remove(&cur->elem);
+            fds_free(cur);
+        }
+        if (!fds_dup(old, newfd)) {
+            lock_release(&file_lock);
+            return -1;
+        }
+        if (newfd >= t->fd) t->fd = newfd + 1;
+    }
+    lock_release(&file_lock);
+    return newfd;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <uio.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "filesys/filesys.h"
@@ -7,18 +8,26 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+// an open file descriptor.  it refers either to a file, or, if pipe
+// isn't NULL, to one end of a pipe
 struct fds {
     int file_desc;
     struct file* file_ptr;
+    struct pipe* pipe;
+    bool pipe_write;                // write end of pipe?
     struct list_elem elem;
 };
 
 void syscall_init (void);
+void fds_free(struct fds*);
+void fds_inherit(struct thread* parent);
 
 void halt(void) NO_RETURN;
 void exit(int status) NO_RETURN;
 pid_t exec(const char *cmd_line);
 int wait(pid_t pid);
+pid_t wait_any(int* status);
+int spawn_many(const char** cmdlines, int cnt, pid_t* pids);
 bool create(const char *file, unsigned initial_size);
 bool remove(const char *file);
 int open(const char *file);
@@ -28,6 +37,15 @@ int write(int fd, const void *buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close (int fd);
+int fsync(int fd);
+void sync(void);
+int pread(int fd, void *buffer, unsigned size, unsigned position);
+int pwrite(int fd, const void *buffer, unsigned size, unsigned position);
+int readv(int fd, const struct iovec* iov, int iovcnt);
+int writev(int fd, const struct iovec* iov, int iovcnt);
+int copy_file_range(int in_fd, int out_fd, unsigned size);
+int pipe(int* pfd);
+int dup2(int oldfd, int newfd);
 
 void* get_physical(const void* uaddr);
 bool validate_addr(const void* uddr);
@@ -0,0 +1,229 @@
+/* hash-bench.c
+
+   Host-side benchmark comparing the chained hash table in
+   lib/kernel/hash.c with the open-addressing table in
+   lib/kernel/ohash.c.  For each table size it times insertion,
+   successful and unsuccessful lookup, and deletion of 32-bit
+   keys, and reports the mean time per operation.
+
+   Build with "make hash-bench" in this directory. */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lib/kernel/hash.h"
+#include "lib/kernel/ohash.h"
+
+/* An element of the chained table. */
+struct elem
+  {
+    struct hash_elem hash_elem;
+    uint32_t key;
+  };
+
+/* Number of times each measurement is repeated.  The fastest
+   run is reported. */
+#define RUNS 5
+
+/* The library code calls this on assertion failure. */
+void
+debug_panic (const char *file, int line, const char *function,
+             const char *message, ...)
+{
+  va_list args;
+
+  fprintf (stderr, "%s:%d: %s(): ", file, line, function);
+  va_start (args, message);
+  vfprintf (stderr, message, args);
+  va_end (args);
+  putc ('\n', stderr);
+  abort ();
+}
+
+static unsigned
+elem_hash (const struct hash_elem *e, void *aux)
+{
+  return hash_int (hash_entry (e, struct elem, hash_elem)->key);
+}
+
+static bool
+elem_less (const struct hash_elem *a, const struct hash_elem *b, void *aux)
+{
+  return (hash_entry (a, struct elem, hash_elem)->key
+          < hash_entry (b, struct elem, hash_elem)->key);
+}
+
+/* Returns the current time in nanoseconds. */
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Fills KEYS and MISSES with CNT pseudo-random keys each.  The
+   keys are successive values of a xorshift generator, which does
+   not repeat a value within 2**32 - 1 steps, so all 2 * CNT keys
+   are distinct. */
+static void
+make_keys (uint32_t *keys, uint32_t *misses, size_t cnt)
+{
+  uint32_t x = 0x12345678;
+  size_t i;
+
+  for (i = 0; i < 2 * cnt; i++)
+    {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      if (i < cnt)
+        keys[i] = x;
+      else
+        misses[i - cnt] = x;
+    }
+}
+
+/* Times for one table at one size, in nanoseconds per
+   operation. */
+struct result
+  {
+    double insert, hit, miss, delete;
+  };
+
+static double
+min (double a, double b)
+{
+  return a < b ? a : b;
+}
+
+static void
+bench_chained (const uint32_t *keys, const uint32_t *misses, size_t cnt,
+               struct result *r)
+{
+  struct elem *elems = malloc (cnt * sizeof *elems);
+  struct hash h;
+  volatile size_t found = 0;
+  size_t i;
+  double t;
+
+  for (i = 0; i < cnt; i++)
+    elems[i].key = keys[i];
+
+  hash_init (&h, elem_hash, elem_less, NULL);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    hash_insert (&h, &elems[i].hash_elem);
+  r->insert = min (r->insert, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct elem probe;
+      probe.key = keys[i];
+      found += hash_find (&h, &probe.hash_elem) != NULL;
+    }
+  r->hit = min (r->hit, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct elem probe;
+      probe.key = misses[i];
+      found += hash_find (&h, &probe.hash_elem) != NULL;
+    }
+  r->miss = min (r->miss, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    {
+      struct elem probe;
+      probe.key = keys[i];
+      found += hash_delete (&h, &probe.hash_elem) != NULL;
+    }
+  r->delete = min (r->delete, (now () - t) / cnt);
+
+  if (found != 2 * cnt || !hash_empty (&h))
+    debug_panic (__FILE__, __LINE__, __func__, "chained table is wrong");
+
+  hash_destroy (&h, NULL);
+  free (elems);
+}
+
+static void
+bench_open (const uint32_t *keys, const uint32_t *misses, size_t cnt,
+            struct result *r)
+{
+  struct elem *elems = malloc (cnt * sizeof *elems);
+  struct ohash h;
+  volatile size_t found = 0;
+  size_t i;
+  double t;
+
+  for (i = 0; i < cnt; i++)
+    elems[i].key = keys[i];
+
+  ohash_init (&h);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    ohash_insert (&h, keys[i], &elems[i]);
+  r->insert = min (r->insert, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    found += ohash_find (&h, keys[i]) != NULL;
+  r->hit = min (r->hit, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    found += ohash_find (&h, misses[i]) != NULL;
+  r->miss = min (r->miss, (now () - t) / cnt);
+
+  t = now ();
+  for (i = 0; i < cnt; i++)
+    found += ohash_delete (&h, keys[i]) != NULL;
+  r->delete = min (r->delete, (now () - t) / cnt);
+
+  if (found != 2 * cnt || !ohash_empty (&h))
+    debug_panic (__FILE__, __LINE__, __func__, "open table is wrong");
+
+  ohash_destroy (&h, NULL, NULL);
+  free (elems);
+}
+
+int
+main (void)
+{
+  static const size_t sizes[] = {1000, 10000, 100000};
+  size_t i;
+
+  printf ("%8s %-8s %8s %8s %8s %8s  (ns/op)\n",
+          "size", "table", "insert", "hit", "miss", "delete");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t cnt = sizes[i];
+      uint32_t *keys = malloc (cnt * sizeof *keys);
+      uint32_t *misses = malloc (cnt * sizeof *misses);
+      struct result chained = {1e9, 1e9, 1e9, 1e9};
+      struct result open = {1e9, 1e9, 1e9, 1e9};
+      int run;
+
+      make_keys (keys, misses, cnt);
+      for (run = 0; run < RUNS; run++)
+        {
+          bench_chained (keys, misses, cnt, &chained);
+          bench_open (keys, misses, cnt, &open);
+        }
+
+      printf ("%8zu %-8s %8.1f %8.1f %8.1f %8.1f\n", cnt, "chained",
+              chained.insert, chained.hit, chained.miss, chained.delete);
+      printf ("%8zu %-8s %8.1f %8.1f %8.1f %8.1f\n", cnt, "open",
+              open.insert, open.hit, open.miss, open.delete);
+      free (keys);
+      free (misses);
+    }
+  return 0;
+}